@@ -9,6 +9,7 @@
 
 #include "R/Funtab.h"
 #include "R/Serialize.h"
+#include "compiler/native/jit_llvm.h"
 #include "compiler/parameter.h"
 #include "compiler/test/PirCheck.h"
 #include "compiler/test/PirTests.h"
@@ -16,11 +17,14 @@
 #include "compiler/translations/rir_2_pir/rir_2_pir.h"
 #include "compiler/translations/rir_2_pir/rir_2_pir_compiler.h"
 #include "interpreter/interp_incl.h"
+#include "interpreter/opcode_profile.h"
+#include "interpreter/sampling_profile.h"
 #include "ir/BC.h"
 #include "ir/Compiler.h"
 
 #include <list>
 #include <memory>
+#include <sstream>
 #include <string>
 
 using namespace rir;
@@ -55,17 +59,20 @@ REXPORT SEXP rir_disassemble(SEXP what, SEXP verbose) {
     if (!t)
         Rf_error("Not a rir compiled code");
 
-    std::cout << "* closure " << what << " (vtable " << t << ", env "
-              << CLOENV(what) << ")\n";
+    // Printed through R, such that it can be captured with capture.output
+    std::stringstream out;
+    out << "* closure " << what << " (vtable " << t << ", env " << CLOENV(what)
+        << ")\n";
     for (size_t entry = 0; entry < t->size(); ++entry) {
         Function* f = t->get(entry);
-        std::cout << "= vtable slot <" << entry << "> (" << f << ", invoked "
-                  << f->invocationCount() << ") =\n";
-        std::cout << "# ";
-        f->signature().print(std::cout);
-        std::cout << "\n";
-        f->disassemble(std::cout);
+        out << "= vtable slot <" << entry << "> (" << f << ", invoked "
+            << f->invocationCount() << ") =\n";
+        out << "# ";
+        f->signature().print(out);
+        out << "\n";
+        f->disassemble(out);
     }
+    Rprintf("%s", out.str().c_str());
 
     return R_NilValue;
 }
@@ -272,6 +279,11 @@ REXPORT SEXP rir_invocation_count(SEXP what) {
     return res;
 }
 
+// Used in test infrastructure to check that arguments are passed by value
+REXPORT SEXP rir_args_passed_by_value() {
+    return Rf_ScalarReal(argsPassedByValue());
+}
+
 REXPORT SEXP pir_compile(SEXP what, SEXP name, SEXP debugFlags,
                          SEXP debugStyle) {
     if (debugFlags != R_NilValue &&
@@ -408,6 +420,63 @@ REXPORT SEXP rirDisableLoopPeeling() {
     return R_NilValue;
 }
 
+REXPORT SEXP rirOpcodeProfileStart(SEXP interval) {
+#ifndef PROFILE_OPCODES
+    Rf_error("rir was built without PROFILE_OPCODES, use the ReleaseProfile "
+             "build type");
+#endif
+    int i = Rf_asInteger(interval);
+    if (i == NA_INTEGER || i < 1)
+        Rf_error("sampling interval must be a positive integer");
+    OpcodeProfile::instance().start(i);
+    return R_NilValue;
+}
+
+REXPORT SEXP rirOpcodeProfileStop() {
+    OpcodeProfile::instance().stop();
+    return R_NilValue;
+}
+
+REXPORT SEXP rirOpcodeProfileReset() {
+    OpcodeProfile::instance().reset();
+    return R_NilValue;
+}
+
+REXPORT SEXP rirOpcodeProfile() { return OpcodeProfile::instance().report(); }
+
+REXPORT SEXP rirProfileStart(SEXP interval) {
+    int i = Rf_asInteger(interval);
+    if (i == NA_INTEGER || i < 1)
+        Rf_error("sampling interval must be a positive number of ms");
+    SamplingProfile::instance().start(i);
+    return R_NilValue;
+}
+
+REXPORT SEXP rirProfileStop() {
+    SamplingProfile::instance().stop();
+    return R_NilValue;
+}
+
+REXPORT SEXP rirProfileReset() {
+    SamplingProfile::instance().reset();
+    return R_NilValue;
+}
+
+REXPORT SEXP rirProfile() { return SamplingProfile::instance().report(); }
+
+// Memory held by compiled code, to be watched in long running sessions
+REXPORT SEXP rir_jitMemory() {
+    SEXP res = PROTECT(Rf_allocVector(REALSXP, 2));
+    SEXP names = PROTECT(Rf_allocVector(STRSXP, 2));
+    SET_STRING_ELT(names, 0, Rf_mkChar("nativeModules"));
+    SET_STRING_ELT(names, 1, Rf_mkChar("nativeBytes"));
+    REAL(res)[0] = pir::JitLLVM::liveModules();
+    REAL(res)[1] = pir::JitLLVM::nativeBytes();
+    Rf_setAttrib(res, R_NamesSymbol, names);
+    UNPROTECT(2);
+    return res;
+}
+
 REXPORT SEXP rirPrintBuiltinIds() {
     FUNTAB* finger = R_FunTab;
     int i = 0;
@@ -0,0 +1,70 @@
+#include "analysis_cache.h"
+#include "../pir/pir_impl.h"
+#include "../util/visitor.h"
+
+namespace rir {
+namespace pir {
+
+void AnalysisCache::invalidate(ClosureVersion* version) {
+    entries.erase(version);
+    for (auto& e : entries) {
+        auto& cached = e.second;
+        for (auto a = cached.begin(); a != cached.end();) {
+            if (a->second.dependencies.count(version))
+                a = cached.erase(a);
+            else
+                a++;
+        }
+    }
+}
+
+void AnalysisCache::invalidateInterprocedural() {
+    for (auto& e : entries) {
+        auto& cached = e.second;
+        for (auto a = cached.begin(); a != cached.end();) {
+            if (!a->second.dependencies.empty())
+                a = cached.erase(a);
+            else
+                a++;
+        }
+    }
+}
+
+void AnalysisCache::clear() {
+    entries.clear();
+    log.flush();
+}
+
+size_t AnalysisCache::fingerprint(ClosureVersion* version) {
+    size_t h = hash_combine(version->properties.to_i(),
+                            version->properties.argumentForceOrder.size());
+    auto hashCode = [&](Code* code) {
+        Visitor::run(code->entry, [&](BB* bb) {
+            h = hash_combine(h, bb);
+            for (auto i : *bb) {
+                // Passes mostly replace instructions instead of updating
+                // them, the few fields updated in place are hashed below
+                h = hash_combine(h, i);
+                h = hash_combine(h, i->tagHash());
+                h = hash_combine(h, i->gvnBase());
+                h = hash_combine(h, i->type);
+                h = hash_combine(h, i->effects.to_i());
+                i->eachArg([&](Value* v) { h = hash_combine(h, v); });
+                if (auto f = Force::Cast(i))
+                    h = hash_combine(h, f->strict);
+                else if (auto mk = MkArg::Cast(i))
+                    h = hash_combine(h, mk->noReflection);
+                else if (auto call = StaticCall::Cast(i))
+                    h = hash_combine(h, call->cls());
+            }
+            for (auto s : bb->succsessors())
+                h = hash_combine(h, s);
+        });
+    };
+    hashCode(version);
+    version->eachPromise([&](Promise* p) { hashCode(p); });
+    return h;
+}
+
+} // namespace pir
+} // namespace rir
@@ -0,0 +1,86 @@
+#ifndef PIR_ANALYSIS_CACHE_H
+#define PIR_ANALYSIS_CACHE_H
+
+#include "../debugging/stream_logger.h"
+#include "../pir/pir.h"
+
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace rir {
+namespace pir {
+
+/*
+ * Keeps static analyses of the versions of a module alive between passes.
+ *
+ * The optimizer runs the same passes over and over, and often a version did
+ * not change since the last time an analysis of it was computed. Passes ask
+ * the cache for an analysis instead of computing it themselves, and the
+ * optimizer invalidates the analyses of a version whenever a pass changes it.
+ * Analyses which look into other versions (i.e. the interprocedural scope
+ * analysis) list them as dependencies and are dropped when one of those
+ * changes, or when new versions are added to the module, since calls might
+ * dispatch to them.
+ *
+ * Cached analyses outlive the pass which computed them, they log to a stream
+ * of their own.
+ */
+class AnalysisCache {
+  public:
+    typedef std::unordered_set<ClosureVersion*> Dependencies;
+
+    // Returns the cached analysis of version, or the one computed by compute.
+    // compute adds all versions, other than version, the result depends on.
+    template <class Analysis>
+    Analysis&
+    get(ClosureVersion* version,
+        const std::function<Analysis*(LogStream&, Dependencies&)>& compute) {
+        auto& cached = entries[version];
+        auto e = cached.find(key<Analysis>());
+        if (e != cached.end())
+            return *static_cast<Analysis*>(e->second.analysis.get());
+
+        Dependencies dependencies;
+        auto analysis = compute(log, dependencies);
+        dependencies.erase(version);
+        cached.emplace(key<Analysis>(),
+                       Cached{std::shared_ptr<Analysis>(analysis),
+                              std::move(dependencies)});
+        return *analysis;
+    }
+
+    // Drops all analyses which depend on version
+    void invalidate(ClosureVersion* version);
+    // Drops all analyses which depend on other versions
+    void invalidateInterprocedural();
+    void clear();
+
+    // Hash of the structure of a version and of the instruction state the
+    // analyses read. Used to find out whether a pass changed a version.
+    static size_t fingerprint(ClosureVersion* version);
+
+    ~AnalysisCache() { clear(); }
+
+  private:
+    struct Cached {
+        std::shared_ptr<void> analysis;
+        Dependencies dependencies;
+    };
+    std::unordered_map<ClosureVersion*,
+                       std::unordered_map<const void*, Cached>>
+        entries;
+    SimpleLogStream log;
+
+    template <class Analysis>
+    static const void* key() {
+        static const char k = 0;
+        return &k;
+    }
+};
+
+} // namespace pir
+} // namespace rir
+
+#endif
@@ -231,7 +231,7 @@ class DeadStoreAnalysis {
             auto observeStaticEnvs = [&]() {
                 for (auto it = state.ignoreStore.begin();
                      it != state.ignoreStore.end();) {
-                    if (Env::isStaticEnv(it->second)) {
+                    if (Env::isPreexistingEnv(it->second)) {
                         it = state.ignoreStore.erase(it);
                         effect.update();
                     } else {
@@ -261,7 +261,7 @@ class DeadStoreAnalysis {
             if (auto ld = LdVar::Cast(i)) {
                 for (auto& e : withPotentialParents(resolveEnv(i->env()))) {
                     Variable var({ld->varName, e});
-                    if (!Env::isStaticEnv(e) &&
+                    if (!Env::isPreexistingEnv(e) &&
                         !state.partiallyObserved.count(var)) {
                         state.partiallyObserved.insert(var);
                         effect.update();
@@ -312,7 +312,7 @@ class DeadStoreAnalysis {
                 return false;
             if (state.completelyObserved.count(st->env()))
                 return true;
-            return Env::isStaticEnv(st->env()) ||
+            return Env::isPreexistingEnv(st->env()) ||
                    state.partiallyObserved.count(var);
         }
     };
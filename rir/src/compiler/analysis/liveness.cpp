@@ -191,9 +191,9 @@ bool LivenessIntervals::interfere(Value* v1, Value* v2) const {
     for (size_t i = 0; i < l1.size(); ++i) {
         const auto& int1 = l1[i];
         const auto& int2 = l2[i];
-        if (int1.live && int2.live) {
-            return int1.begin <= int2.end && int2.begin <= int1.end;
-        }
+        if (int1.live && int2.live && int1.begin <= int2.end &&
+            int2.begin <= int1.end)
+            return true;
     }
     return false;
 }
@@ -6,6 +6,9 @@
 #include "generic_static_analysis.h"
 #include "utils/Map.h"
 
+#include <unordered_map>
+#include <unordered_set>
+
 namespace rir {
 namespace pir {
 
@@ -19,6 +22,12 @@ struct NeedsRefcountAdjustment {
     SmallMap<Instruction*, Kind> atCreation;
     SmallMap<Instruction*, SmallMap<Instruction*, Kind>> beforeUse;
 
+    // Arithmetic for `x <- x op y`, where the lhs was loaded from the local
+    // variable x just for this instruction and the result is stored back into
+    // x right after. Unless the binding is shared, the old value of x is dead
+    // afterwards and can be updated in place.
+    std::unordered_set<Instruction*> overwritesVariable;
+
     void print(std::ostream& out, bool tty) const {
         out << "Adjust at creation:\n";
         for (auto r : atCreation) {
@@ -38,6 +47,13 @@ struct NeedsRefcountAdjustment {
             out << "\n";
         }
         out << "\n";
+
+        out << "Overwrites variable: ";
+        for (auto i : overwritesVariable) {
+            i->printRef(out);
+            out << ",  ";
+        }
+        out << "\n";
     }
 };
 
@@ -177,10 +193,127 @@ class StaticReferenceCount
         : StaticAnalysis("StaticReferenceCountAnalysis", cls, cls, log),
           dom(cls) {
         globalState = new NeedsRefcountAdjustment;
+        findVariableUpdates(cls);
     }
 
     ~StaticReferenceCount() { delete globalState; }
 
+  private:
+    // Instructions whose result is their (first) argument
+    static bool passesThrough(Instruction* i) {
+        return CastType::Cast(i) || Force::Cast(i) || ChkMissing::Cast(i);
+    }
+
+    void findVariableUpdates(ClosureVersion* cls) {
+        std::unordered_map<Value*, std::vector<Instruction*>> uses;
+        std::unordered_map<Instruction*, size_t> position;
+        std::vector<LdVar*> loads;
+        Visitor::run(cls->entry, [&](BB* bb) {
+            size_t pos = 0;
+            for (auto i : *bb) {
+                position[i] = pos++;
+                i->eachArg([&](Value* v) { uses[v].push_back(i); });
+                if (auto ld = LdVar::Cast(i))
+                    loads.push_back(ld);
+            }
+        });
+        auto before = [&](Instruction* a, Instruction* b) {
+            return a->bb() == b->bb() && position.at(a) < position.at(b);
+        };
+
+        for (auto ld : loads) {
+            auto env = MkEnv::Cast(ld->env());
+            if (!env)
+                continue;
+            // Stubs do not count the references of their initial bindings
+            if (env->stub) {
+                bool bound = false;
+                env->eachLocalVar([&](SEXP name, Value* v, bool) {
+                    if (name == ld->varName && v != UnboundValue::instance())
+                        bound = true;
+                });
+                if (bound)
+                    continue;
+            }
+
+            // The loaded value goes straight into the arithmetic
+            Instruction* lhs = nullptr;
+            Instruction* i = ld;
+            while (i && (i == ld || passesThrough(i))) {
+                auto& u = uses[i];
+                lhs = i;
+                i = u.size() == 1 && u[0]->bb() == ld->bb() ? u[0] : nullptr;
+            }
+            if (!i || i->arg(0).val() != lhs)
+                continue;
+            switch (i->tag) {
+            case Tag::Add:
+            case Tag::Sub:
+            case Tag::Mul:
+            case Tag::Div:
+                break;
+            default:
+                continue;
+            }
+
+            // The result is stored back into the same variable right away
+            auto bb = ld->bb();
+            auto next = bb->atPosition(i) + 1;
+            while (next != bb->end() && CastType::Cast(*next))
+                next++;
+            auto st = next == bb->end() ? nullptr : StVar::Cast(*next);
+            if (!st || st->isStArg || st->varName != ld->varName ||
+                st->env() != ld->env() || st->val()->followCasts() != i)
+                continue;
+
+            // Nobody else can change or observe x in between
+            bool ok = true;
+            for (auto j = bb->atPosition(ld) + 1; *j != i; ++j)
+                if ((*j)->effects.contains(Effect::WritesEnv) ||
+                    (*j)->effects.contains(Effect::ExecuteCode) ||
+                    (*j)->effects.contains(Effect::Force) ||
+                    (*j)->effects.contains(Effect::Reflection))
+                    ok = false;
+
+            // Other loads of x must be dead by now. Otherwise they would see
+            // the update, since they are not counted as references.
+            std::function<bool(Instruction*, BB*)> live = [&](Instruction* v,
+                                                              BB* home) {
+                for (auto u : uses[v]) {
+                    if (u->bb() != home || (home == bb && !before(u, ld)))
+                        return true;
+                    switch (u->tag) {
+                    case Tag::Phi:
+                    case Tag::MkArg:
+                    case Tag::FrameState:
+                    case Tag::MkEnv:
+                    case Tag::StVar:
+                    case Tag::StVarSuper:
+                    case Tag::UpdatePromise:
+                        return true;
+                    default:
+                        break;
+                    }
+                    if (passesThrough(u) && live(u, home))
+                        return true;
+                }
+                return false;
+            };
+            for (auto other : loads) {
+                if (!ok)
+                    break;
+                if (other == ld || other->varName != ld->varName ||
+                    other->env() != ld->env() || before(st, other))
+                    continue;
+                if (live(other, other->bb()))
+                    ok = false;
+            }
+
+            if (ok)
+                globalState->overwritesVariable.insert(i);
+        }
+    }
+
   protected:
     AbstractResult apply(AbstractValueTaint& state,
                          Instruction* i) const override {
@@ -13,6 +13,15 @@ ScopeAnalysis::ScopeAnalysis(ClosureVersion* cls, Promise* prom, Value* promEnv,
     : StaticAnalysis("Scope", cls, prom, initialState, globalState, log),
       depth(depth), staticClosureEnv(promEnv) {}
 
+ScopeAnalysisState ScopeAnalysis::initialState(ClosureVersion* cls) {
+    ScopeAnalysisState state;
+    // Regions run in the env of the function they were outlined from. Closures
+    // and promises created before the region was entered can modify it.
+    if (cls->owner()->rirFunction()->region)
+        state.envs.leak(Env::notClosed());
+    return state;
+}
+
 void ScopeAnalysis::lookup(Value* v, const LoadMaybe& action,
                            const Maybe& notFound) const {
     auto instr = Instruction::Cast(v);
@@ -168,7 +177,8 @@ AbstractResult ScopeAnalysis::doCompute(ScopeAnalysisState& state,
     } else if (auto le = LdFunctionEnv::Cast(i)) {
         // LdFunctionEnv happen inside promises and refer back to the caller
         // environment, ie. the instruction that created the promise.
-        assert(staticClosureEnv != Env::notClosed());
+        assert(staticClosureEnv != Env::notClosed() ||
+               closure->owner()->rirFunction()->region);
         assert(!state.envs.aliases.count(le) ||
                state.envs.aliases.at(le) == staticClosureEnv);
         state.envs.aliases[le] = staticClosureEnv;
@@ -332,6 +342,8 @@ AbstractResult ScopeAnalysis::doCompute(ScopeAnalysisState& state,
             if (version->size() > MAX_SIZE)
                 return;
 
+            globalState->dependencies.insert(version);
+
             std::vector<Value*> args;
             calli->eachCallArg([&](Value* v) { args.push_back(v); });
             ScopeAnalysis nextFun(version, args, lexicalEnv, state, globalState,
@@ -23,6 +23,8 @@ namespace pir {
 struct ScopeAnalysisResults {
     std::unordered_map<Instruction*, AbstractLoad> results;
     std::unordered_map<Instruction*, AbstractPirValue> returnValues;
+    // Versions analyzed interprocedurally
+    std::unordered_set<ClosureVersion*> dependencies;
     bool _changed;
     void resetChanged() { _changed = false; }
     bool changed() const { return _changed; }
@@ -98,6 +100,8 @@ class ScopeAnalysis
 
     ScopeAnalysisResults* globalStateStore = nullptr;
 
+    static ScopeAnalysisState initialState(ClosureVersion* cls);
+
   protected:
     AbstractResult compute(ScopeAnalysisState& state, Instruction* i) override {
         return doCompute(state, i, true);
@@ -112,7 +116,8 @@ class ScopeAnalysis
 
     // Default
     ScopeAnalysis(ClosureVersion* cls, LogStream& log)
-        : StaticAnalysis("Scope", cls, cls, log), depth(0) {
+        : StaticAnalysis("Scope", cls, cls, initialState(cls), nullptr, log),
+          depth(0) {
         globalState = globalStateStore = new ScopeAnalysisResults;
     }
 
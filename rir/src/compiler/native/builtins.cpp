@@ -6,6 +6,7 @@
 #include "interpreter/cache.h"
 #include "interpreter/call_context.h"
 #include "interpreter/interp.h"
+#include "interpreter/sampling_profile.h"
 #include "ir/Deoptimization.h"
 #include "utils/Pool.h"
 
@@ -13,6 +14,8 @@
 #include "R/Symbols.h"
 #include <R_ext/RS.h> /* for Memzero */
 
+#include <algorithm>
+
 namespace rir {
 namespace pir {
 
@@ -373,10 +376,12 @@ NativeBuiltin NativeBuiltins::callBuiltin = {
 };
 
 static SEXP callImpl(rir::Code* c, Immediate ast, SEXP callee, SEXP env,
-                     size_t nargs, unsigned long available) {
+                     size_t nargs, unsigned long available,
+                     CallSiteCache* cache) {
     auto ctx = globalContext();
     CallContext call(c, callee, nargs, ast, ostack_cell_at(ctx, nargs - 1), env,
                      Assumptions(available), ctx);
+    call.cache = cache;
     SLOWASSERT(env == symbol::delayedEnv || TYPEOF(env) == ENVSXP ||
                LazyEnvironment::check(env));
     SLOWASSERT(ctx);
@@ -391,10 +396,11 @@ NativeBuiltin NativeBuiltins::call = {
 
 static SEXP namedCallImpl(rir::Code* c, Immediate ast, SEXP callee, SEXP env,
                           size_t nargs, Immediate* names,
-                          unsigned long available) {
+                          unsigned long available, CallSiteCache* cache) {
     auto ctx = globalContext();
     CallContext call(c, callee, nargs, ast, ostack_cell_at(ctx, nargs - 1),
                      names, env, Assumptions(available), ctx);
+    call.cache = cache;
     SLOWASSERT(env == symbol::delayedEnv || TYPEOF(env) == ENVSXP ||
                LazyEnvironment::check(env));
     SLOWASSERT(ctx);
@@ -409,7 +415,7 @@ NativeBuiltin NativeBuiltins::namedCall = {
 
 static SEXP dotsCallImpl(rir::Code* c, Immediate ast, SEXP callee, SEXP env,
                          size_t nargs, Immediate* names,
-                         unsigned long available) {
+                         unsigned long available, CallSiteCache* cache) {
     auto ctx = globalContext();
     auto given = Assumptions(available);
     auto toPop = nargs;
@@ -428,6 +434,7 @@ static SEXP dotsCallImpl(rir::Code* c, Immediate ast, SEXP callee, SEXP env,
 
     CallContext call(c, callee, nargs, ast, ostack_cell_at(ctx, nargs - 1),
                      names, env, given, ctx);
+    call.cache = cache;
     SLOWASSERT(env == symbol::delayedEnv || TYPEOF(env) == ENVSXP ||
                LazyEnvironment::check(env));
     SLOWASSERT(ctx);
@@ -691,12 +698,224 @@ static SEXP notImpl(SEXP argument) {
 
 NativeBuiltin NativeBuiltins::notOp = {"not", (void*)&notImpl};
 
+static inline bool isNA(int x) { return x == NA_INTEGER; }
+static inline bool isNA(double x) { return ISNAN(x); }
+static inline double toReal(int x) { return x == NA_INTEGER ? NA_REAL : x; }
+static inline double toReal(double x) { return x; }
+
+// Applies op to the elements of l and r, recycling the shorter one. res may
+// be one of the operands, if it has the full length.
+template <typename Res, typename L, typename R, typename Op>
+static void elementwise(Res* res, R_xlen_t n, const L* l, R_xlen_t nl,
+                        const R* r, R_xlen_t nr, Op op) {
+    if (nl == n && nr == n) {
+        for (R_xlen_t i = 0; i < n; ++i)
+            res[i] = op(l[i], r[i]);
+    } else if (nr == 1) {
+        auto y = r[0];
+        for (R_xlen_t i = 0; i < n; ++i)
+            res[i] = op(l[i], y);
+    } else if (nl == 1) {
+        auto x = l[0];
+        for (R_xlen_t i = 0; i < n; ++i)
+            res[i] = op(x, r[i]);
+    } else {
+        for (R_xlen_t i = 0, il = 0, ir = 0; i < n; ++i) {
+            res[i] = op(l[il], r[ir]);
+            if (++il == nl)
+                il = 0;
+            if (++ir == nr)
+                ir = 0;
+        }
+    }
+}
+
+#define ELEMENTWISE(Res, expr)                                                 \
+    elementwise(Res(res), XLENGTH(res), l, nl, r, nr,                          \
+                [](L x, R y) { return expr; })
+
+// Comparisons, and arithmetic with a real result
+template <typename L, typename R>
+static void vectorBinop(SEXP res, BinopKind kind, const L* l, R_xlen_t nl,
+                        const R* r, R_xlen_t nr) {
+#define RELOP(op)                                                              \
+    ELEMENTWISE(LOGICAL, (isNA(x) || isNA(y))                                  \
+                             ? NA_LOGICAL                                      \
+                             : (int)(toReal(x) op toReal(y)))
+    switch (kind) {
+    case BinopKind::ADD:
+        ELEMENTWISE(REAL, toReal(x) + toReal(y));
+        break;
+    case BinopKind::SUB:
+        ELEMENTWISE(REAL, toReal(x) - toReal(y));
+        break;
+    case BinopKind::MUL:
+        ELEMENTWISE(REAL, toReal(x) * toReal(y));
+        break;
+    case BinopKind::DIV:
+        ELEMENTWISE(REAL, toReal(x) / toReal(y));
+        break;
+    case BinopKind::EQ:
+        RELOP(==);
+        break;
+    case BinopKind::NE:
+        RELOP(!=);
+        break;
+    case BinopKind::LT:
+        RELOP(<);
+        break;
+    case BinopKind::LTE:
+        RELOP(<=);
+        break;
+    case BinopKind::GT:
+        RELOP(>);
+        break;
+    case BinopKind::GTE:
+        RELOP(>=);
+        break;
+    default:
+        assert(false);
+    }
+#undef RELOP
+}
+#undef ELEMENTWISE
+
+// Integer arithmetic, overflows produce NA
+static bool intBinop(SEXP res, BinopKind kind, const int* l, R_xlen_t nl,
+                     const int* r, R_xlen_t nr) {
+    bool overflow = false;
+    auto checked = [&](bool failed, int x, int y, int z) {
+        if (x == NA_INTEGER || y == NA_INTEGER)
+            return NA_INTEGER;
+        if (failed || z == NA_INTEGER) {
+            overflow = true;
+            return NA_INTEGER;
+        }
+        return z;
+    };
+    switch (kind) {
+    case BinopKind::ADD:
+        elementwise(INTEGER(res), XLENGTH(res), l, nl, r, nr,
+                    [&](int x, int y) {
+                        int z;
+                        return checked(__builtin_add_overflow(x, y, &z), x,
+                                       y, z);
+                    });
+        break;
+    case BinopKind::SUB:
+        elementwise(INTEGER(res), XLENGTH(res), l, nl, r, nr,
+                    [&](int x, int y) {
+                        int z;
+                        return checked(__builtin_sub_overflow(x, y, &z), x,
+                                       y, z);
+                    });
+        break;
+    case BinopKind::MUL:
+        elementwise(INTEGER(res), XLENGTH(res), l, nl, r, nr,
+                    [&](int x, int y) {
+                        int z;
+                        return checked(__builtin_mul_overflow(x, y, &z), x,
+                                       y, z);
+                    });
+        break;
+    default:
+        assert(false);
+    }
+    return overflow;
+}
+
+// Element-wise arithmetic and comparisons of plain int, real and logical
+// vectors, i.e. without attributes, do not need to go through R's arith. The
+// result is the same as with R, including NAs, recycling and integer
+// overflows, and an operand nobody else references is reused for the result.
+// Returns nullptr for everything else, or if the lengths of the operands are
+// not multiples of each other (R warns about that).
+// If ownsLhs, then lhs is only bound to the variable the result will be stored
+// into, thus it can be reused unless the binding is shared.
+static SEXP vectorBinop(SEXP call, SEXP lhs, SEXP rhs, BinopKind kind,
+                        bool ownsLhs = false) {
+    auto plain = [](SEXP v) {
+        auto t = TYPEOF(v);
+        return (t == INTSXP || t == REALSXP || t == LGLSXP) &&
+               ATTRIB(v) == R_NilValue;
+    };
+    if (!plain(lhs) || !plain(rhs))
+        return nullptr;
+
+    bool relop;
+    switch (kind) {
+    case BinopKind::ADD:
+    case BinopKind::SUB:
+    case BinopKind::MUL:
+    case BinopKind::DIV:
+        relop = false;
+        break;
+    case BinopKind::EQ:
+    case BinopKind::NE:
+    case BinopKind::LT:
+    case BinopKind::LTE:
+    case BinopKind::GT:
+    case BinopKind::GTE:
+        relop = true;
+        break;
+    default:
+        return nullptr;
+    }
+
+    R_xlen_t nl = XLENGTH(lhs), nr = XLENGTH(rhs);
+    if (nl == 0 || nr == 0)
+        return nullptr;
+    R_xlen_t n = std::max(nl, nr);
+    if (n % nl != 0 || n % nr != 0)
+        return nullptr;
+
+    bool realL = TYPEOF(lhs) == REALSXP, realR = TYPEOF(rhs) == REALSXP;
+    SEXPTYPE type = relop ? LGLSXP
+                          : (realL || realR || kind == BinopKind::DIV)
+                                ? REALSXP
+                                : INTSXP;
+
+    // Comparisons never reuse their operands (see StaticReferenceCount). An
+    // integer overflow warning can be turned into an error, after which the
+    // variable must still hold its old value.
+    bool reuseLhs = NO_REFERENCES(lhs) ||
+                    (ownsLhs && type == REALSXP && !MAYBE_SHARED(lhs));
+    SEXP res;
+    if (!relop && TYPEOF(lhs) == type && nl == n && reuseLhs)
+        res = lhs;
+    else if (!relop && TYPEOF(rhs) == type && nr == n && NO_REFERENCES(rhs))
+        res = rhs;
+    else
+        res = Rf_allocVector(type, n);
+
+    if (type == INTSXP) {
+        if (intBinop(res, kind, INTEGER(lhs), nl, INTEGER(rhs), nr)) {
+            PROTECT(res);
+            Rf_warningcall(call, "NAs produced by integer overflow");
+            UNPROTECT(1);
+        }
+    } else if (realL && realR) {
+        vectorBinop(res, kind, REAL(lhs), nl, REAL(rhs), nr);
+    } else if (realL) {
+        vectorBinop(res, kind, REAL(lhs), nl, INTEGER(rhs), nr);
+    } else if (realR) {
+        vectorBinop(res, kind, INTEGER(lhs), nl, REAL(rhs), nr);
+    } else {
+        vectorBinop(res, kind, INTEGER(lhs), nl, INTEGER(rhs), nr);
+    }
+    R_Visible = (Rboolean) true;
+    return res;
+}
+
 static SEXP binopEnvImpl(SEXP lhs, SEXP rhs, SEXP env, Immediate srcIdx,
                          BinopKind kind) {
     SEXP res = nullptr;
+    SEXP call = src_pool_at(globalContext(), srcIdx);
+    if ((res = vectorBinop(call, lhs, rhs, kind)))
+        return res;
+
     SEXP arglist2 = CONS_NR(rhs, R_NilValue);
     SEXP arglist = CONS_NR(lhs, arglist2);
-    SEXP call = src_pool_at(globalContext(), srcIdx);
 
     PROTECT(arglist);
     switch (kind) {
@@ -791,6 +1010,9 @@ static SEXP binopImpl(SEXP lhs, SEXP rhs, BinopKind kind) {
         debugBinopImpl = true;
     }
 
+    if ((res = vectorBinop(call, lhs, rhs, kind)))
+        return res;
+
     // Why we do not need a protect here?
     switch (kind) {
     case BinopKind::ADD:
@@ -897,6 +1119,34 @@ NativeBuiltin NativeBuiltins::binop = {
     (void*)&binopImpl,
 };
 
+// Variants of binop(Env) for `x <- x op y`, where the lhs was loaded from the
+// variable x just for this operation (see StaticReferenceCount).
+static SEXP binopEnvInPlaceImpl(SEXP lhs, SEXP rhs, SEXP env, Immediate srcIdx,
+                                BinopKind kind) {
+    SEXP res = nullptr;
+    SEXP call = src_pool_at(globalContext(), srcIdx);
+    if ((res = vectorBinop(call, lhs, rhs, kind, true)))
+        return res;
+    return binopEnvImpl(lhs, rhs, env, srcIdx, kind);
+}
+
+NativeBuiltin NativeBuiltins::binopEnvInPlace = {
+    "binopEnvInPlace",
+    (void*)&binopEnvInPlaceImpl,
+};
+
+static SEXP binopInPlaceImpl(SEXP lhs, SEXP rhs, BinopKind kind) {
+    SEXP res = nullptr;
+    if ((res = vectorBinop(R_NilValue, lhs, rhs, kind, true)))
+        return res;
+    return binopImpl(lhs, rhs, kind);
+}
+
+NativeBuiltin NativeBuiltins::binopInPlace = {
+    "binopInPlace",
+    (void*)&binopInPlaceImpl,
+};
+
 int isMissingImpl(SEXP symbol, SEXP environment) {
     // TODO: Send the proper src
     return rir::isMissing(symbol, environment, nullptr, nullptr);
@@ -985,6 +1235,10 @@ void deoptImpl(Code* c, SEXP cls, DeoptMetadata* m, R_bcstack_t* args) {
         stackHeight += m->frames[i].stackSize + 1;
     }
 
+    // Like deopt_ in the interpreter, also count it on the baseline we land
+    // in. This delays and eventually abandons recompiling a function whose
+    // native versions keep deoptimizing.
+    m->frames[m->numFrames - 1].code->registerDeopt();
     c->registerDeopt();
     SEXP env =
         ostack_at(ctx, stackHeight - m->frames[m->numFrames - 1].stackSize - 1);
@@ -1361,6 +1615,8 @@ void initClosureContext(SEXP ast, RCNTXT* cntxt, SEXP rho, SEXP sysparent,
                         R_GlobalContext->sysparent, arglist, op);
     else
         Rf_begincontext(cntxt, CTXT_RETURN, ast, rho, sysparent, arglist, op);
+    // No version recorded yet, see SamplingProfile::setVersion
+    cntxt->cenddata = nullptr;
 }
 
 static void endClosureContext(RCNTXT* cntxt, SEXP result) {
@@ -1375,7 +1631,8 @@ static SEXP nativeCallTrampolineImpl(SEXP callee, rir::Function* fun,
                env == R_NilValue || LazyEnvironment::check(env));
 
     if (fun->dead || !fun->body()->nativeCode)
-        return callImpl(fun->body(), astP, callee, env, nargs, available);
+        return callImpl(fun->body(), astP, callee, env, nargs, available,
+                        nullptr);
 
     auto missing = fun->signature().numArguments - nargs;
     for (size_t i = 0; i < missing; ++i)
@@ -1398,11 +1655,19 @@ static SEXP nativeCallTrampolineImpl(SEXP callee, rir::Function* fun,
     PROTECT(fun->container());
 
     initClosureContext(ast, &cntxt, symbol::delayedEnv, env, arglist, callee);
+    SamplingProfile::setVersion(&cntxt, fun);
+    SamplingProfile::safepoint();
     R_Srcref = getAttrib(callee, symbol::srcref);
 
     // TODO debug
 
-    SEXP result = rirCallTrampoline_(cntxt, fun->body(), args, env, callee);
+    SEXP result;
+    if (fun->signature().jumpTarget) {
+        result = rirCallTrampoline_(cntxt, fun->body(), args, env, callee);
+    } else {
+        fun->body()->registerInvocation();
+        result = fun->body()->nativeCode(fun->body(), args, env, callee);
+    }
 
     endClosureContext(&cntxt, result);
 
@@ -2135,6 +2400,8 @@ void initClosureContextImpl(SEXP ast, RCNTXT* cntxt, SEXP sysparent, SEXP op) {
     else
         Rf_begincontext(cntxt, CTXT_RETURN, ast, symbol::delayedEnv, sysparent,
                         symbol::delayedArglist, op);
+    // Contexts of inlined closures have no version
+    cntxt->cenddata = nullptr;
 }
 
 NativeBuiltin NativeBuiltins::initClosureContext = {
@@ -97,6 +97,8 @@ struct NativeBuiltins {
     static NativeBuiltin notEnv;
     static NativeBuiltin binop;
     static NativeBuiltin binopEnv;
+    static NativeBuiltin binopInPlace;
+    static NativeBuiltin binopEnvInPlace;
     static NativeBuiltin unop;
     static NativeBuiltin unopEnv;
 
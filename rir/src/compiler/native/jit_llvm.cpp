@@ -1,5 +1,6 @@
 #include "jit_llvm.h"
 
+#include "compiler/parameter.h"
 #include "types_llvm.h"
 
 #include <llvm/ADT/STLExtras.h>
@@ -10,6 +11,7 @@
 #include <llvm/Analysis/TargetTransformInfo.h>
 #include <llvm/Analysis/TypeBasedAliasAnalysis.h>
 #include <llvm/ExecutionEngine/ExecutionEngine.h>
+#include <llvm/ExecutionEngine/JITEventListener.h>
 #include <llvm/ExecutionEngine/JITSymbol.h>
 #include <llvm/ExecutionEngine/Orc/CompileUtils.h>
 #include <llvm/ExecutionEngine/Orc/IRCompileLayer.h>
@@ -22,6 +24,7 @@
 #include <llvm/IR/LegacyPassManager.h>
 #include <llvm/IR/Mangler.h>
 #include <llvm/IR/Verifier.h>
+#include <llvm/Object/SymbolSize.h>
 #include <llvm/Support/DynamicLibrary.h>
 #include <llvm/Support/Error.h>
 #include <llvm/Support/TargetSelect.h>
@@ -38,7 +41,16 @@
 #include <llvm/Transforms/IPO.h>
 #include <unordered_map>
 
+#include <cstdio>
+#include <cstring>
 #include <iostream>
+#include <unistd.h>
+
+bool rir::pir::Parameter::JIT_DEBUG_INFO =
+    getenv("PIR_JIT_DEBUG_INFO") &&
+    0 == strncmp("1", getenv("PIR_JIT_DEBUG_INFO"), 1);
+bool rir::pir::Parameter::PERF_MAP =
+    getenv("PIR_PERF_MAP") && 0 == strncmp("1", getenv("PIR_PERF_MAP"), 1);
 
 namespace {
 
@@ -47,6 +59,65 @@ using namespace llvm::orc;
 
 LLVMContext& C = rir::pir::JitLLVM::C;
 
+size_t nativeBytes = 0;
+
+// Every module gets its own memory manager, which frees the sections of the
+// module when it is removed. Counts them to report the memory of native code.
+class CountingMemoryManager : public SectionMemoryManager {
+    size_t allocated = 0;
+
+  public:
+    uint8_t* allocateCodeSection(uintptr_t size, unsigned alignment,
+                                 unsigned id, StringRef name) override {
+        allocated += size;
+        nativeBytes += size;
+        return SectionMemoryManager::allocateCodeSection(size, alignment, id,
+                                                         name);
+    }
+
+    uint8_t* allocateDataSection(uintptr_t size, unsigned alignment,
+                                 unsigned id, StringRef name,
+                                 bool readOnly) override {
+        allocated += size;
+        nativeBytes += size;
+        return SectionMemoryManager::allocateDataSection(size, alignment, id,
+                                                         name, readOnly);
+    }
+
+    ~CountingMemoryManager() { nativeBytes -= allocated; }
+};
+
+// Appends the functions of a loaded object to /tmp/perf-<pid>.map, where perf
+// looks up symbols of jitted code
+static void writePerfMap(const object::ObjectFile& obj,
+                         const RuntimeDyld::LoadedObjectInfo& info) {
+    static FILE* perfMap = nullptr;
+    if (!perfMap) {
+        auto name = "/tmp/perf-" + std::to_string(getpid()) + ".map";
+        perfMap = fopen(name.c_str(), "a");
+        if (!perfMap)
+            return;
+    }
+
+    auto debugObj = info.getObjectForDebug(obj);
+    if (!debugObj.getBinary())
+        return;
+    for (const auto& sym : object::computeSymbolSizes(*debugObj.getBinary())) {
+        auto type = sym.first.getType();
+        auto name = sym.first.getName();
+        auto adr = sym.first.getAddress();
+        if (!type || !name || !adr || *type != object::SymbolRef::ST_Function) {
+            consumeError(type.takeError());
+            consumeError(name.takeError());
+            consumeError(adr.takeError());
+            continue;
+        }
+        fprintf(perfMap, "%lx %lx %s\n", (unsigned long)*adr,
+                (unsigned long)sym.second, name->str().c_str());
+    }
+    fflush(perfMap);
+}
+
 class JitLLVMImplementation {
   private:
     ExecutionSession ES;
@@ -65,6 +136,11 @@ class JitLLVMImplementation {
 
     orc::VModuleKey moduleKey;
 
+    // Registers objects with gdb (PIR_JIT_DEBUG_INFO) and writes jitdump
+    // records, if llvm was built with perf support (PIR_PERF_MAP)
+    JITEventListener* gdbListener = nullptr;
+    JITEventListener* perfListener = nullptr;
+
   public:
     llvm::Module* module = nullptr;
     JitLLVMImplementation()
@@ -77,12 +153,29 @@ class JitLLVMImplementation {
                   cantFail(std::move(Err), "lookupFlags failed");
               })),
           TM(EngineBuilder().selectTarget()), DL(TM->createDataLayout()),
-          ObjectLayer(ES,
-                      [this](VModuleKey K) {
-                          return LegacyRTDyldObjectLinkingLayer::Resources{
-                              std::make_shared<SectionMemoryManager>(),
-                              Resolver};
-                      }),
+          ObjectLayer(
+              ES,
+              [this](VModuleKey K) {
+                  return LegacyRTDyldObjectLinkingLayer::Resources{
+                      std::make_shared<CountingMemoryManager>(), Resolver};
+              },
+              [this](VModuleKey K, const object::ObjectFile& obj,
+                     const RuntimeDyld::LoadedObjectInfo& info) {
+                  if (gdbListener)
+                      gdbListener->notifyObjectLoaded(K, obj, info);
+                  if (perfListener)
+                      perfListener->notifyObjectLoaded(K, obj, info);
+                  if (rir::pir::Parameter::PERF_MAP)
+                      writePerfMap(obj, info);
+              },
+              [](VModuleKey, const object::ObjectFile&,
+                 const RuntimeDyld::LoadedObjectInfo&) {},
+              [this](VModuleKey K, const object::ObjectFile&) {
+                  if (gdbListener)
+                      gdbListener->notifyFreeingObject(K);
+                  if (perfListener)
+                      perfListener->notifyFreeingObject(K);
+              }),
           CompileLayer(ObjectLayer, SimpleCompiler(*TM)),
           OptimizeLayer(CompileLayer,
                         [this](std::unique_ptr<llvm::Module> M) {
@@ -90,11 +183,18 @@ class JitLLVMImplementation {
                         }),
           Mangle(ES, this->DL) {
         llvm::sys::DynamicLibrary::LoadLibraryPermanently(nullptr);
+        if (rir::pir::Parameter::JIT_DEBUG_INFO)
+            gdbListener = JITEventListener::createGDBRegistrationListener();
+        if (rir::pir::Parameter::PERF_MAP)
+            perfListener = JITEventListener::createPerfJITEventListener();
         TM->setMachineOutliner(true);
         TM->setFastISel(true);
     }
 
     std::unordered_map<rir::pir::ClosureVersion*, llvm::Function*> funs;
+    // Modules by the address of the function compiled into them
+    std::unordered_map<void*, VModuleKey> modules;
+
     void createModule() {
         module = new llvm::Module("", C);
         module->setDataLayout(TM->createDataLayout());
@@ -129,14 +229,23 @@ class JitLLVMImplementation {
         module = nullptr;
         auto res = findSymbol(name);
         auto adr = res.getAddress();
-        // cantFail(OptimizeLayer.removeModule(K));
         if (adr) {
             assert(*adr);
+            modules[(void*)*adr] = moduleKey;
             return (void*)*adr;
         }
+        removeModule(moduleKey);
         return nullptr;
     }
 
+    void release(void* native) {
+        auto m = modules.find(native);
+        if (m == modules.end())
+            return;
+        removeModule(m->second);
+        modules.erase(m);
+    }
+
     static JitLLVMImplementation& instance() {
         static std::unique_ptr<JitLLVMImplementation> singleton;
         if (!singleton) {
@@ -163,6 +272,13 @@ class JitLLVMImplementation {
     }
 
   private:
+    void removeModule(VModuleKey key) {
+        cantFail(OptimizeLayer.removeModule(key));
+        ES.releaseVModule(key);
+        if (key == moduleKey)
+            moduleKey = -1;
+    }
+
     JITSymbol findMangledSymbol(const std::string& Name) {
 #ifdef _WIN32
         // The symbol lookup of ObjectLinkingLayer uses the
@@ -211,6 +327,11 @@ class JitLLVMImplementation {
 
 static void pirPassSchedule(const PassManagerBuilder&,
                             legacy::PassManagerBase& PM) {
+    // The default alias analyses are only added after this extension point,
+    // but lower_llvm tags all heap accesses for TBAA
+    PM.add(createTypeBasedAAWrapperPass());
+    PM.add(createScopedNoAliasAAWrapperPass());
+
     PM.add(createDeadInstEliminationPass());
 
     PM.add(createCFGSimplificationPass());
@@ -351,6 +472,16 @@ void* JitLLVM::tryCompile(llvm::Function* fun) {
     return JitLLVMImplementation::instance().tryCompile(fun);
 }
 
+void JitLLVM::release(void* native) {
+    JitLLVMImplementation::instance().release(native);
+}
+
+size_t JitLLVM::liveModules() {
+    return JitLLVMImplementation::instance().modules.size();
+}
+
+size_t JitLLVM::nativeBytes() { return ::nativeBytes; }
+
 llvm::Function* JitLLVM::get(ClosureVersion* v) {
     return JitLLVMImplementation::instance().getFunction(v);
 }
@@ -16,6 +16,10 @@ class JitLLVM {
     static void createModule();
     static llvm::Module& module();
     static void* tryCompile(llvm::Function*);
+    // Frees the module of native code returned by tryCompile
+    static void release(void* native);
+    static size_t liveModules();
+    static size_t nativeBytes();
     static llvm::Function* declare(ClosureVersion* v, const std::string& name,
                                    llvm::FunctionType* signature);
     static llvm::Function* get(ClosureVersion* v);
@@ -2,6 +2,7 @@
 
 #include "../analysis/reference_count.h"
 #include "types_llvm.h"
+#include "llvm/IR/DIBuilder.h"
 #include "llvm/IR/IRBuilder.h"
 #include "llvm/IR/Intrinsics.h"
 #include "llvm/IR/MDBuilder.h"
@@ -12,10 +13,12 @@
 #include "R/r.h"
 #include "builtins.h"
 #include "compiler/analysis/liveness.h"
+#include "compiler/parameter.h"
 #include "compiler/pir/pir_impl.h"
 #include "compiler/util/visitor.h"
 #include "interpreter/LazyEnvironment.h"
 #include "interpreter/builtins.h"
+#include "interpreter/call_context.h"
 #include "interpreter/instance.h"
 #include "runtime/DispatchTable.h"
 #include "utils/Pool.h"
@@ -23,11 +26,16 @@
 #include <algorithm>
 #include <cassert>
 #include <cstdlib>
+#include <fstream>
 #include <map>
 #include <memory>
 #include <string>
+#include <sys/stat.h>
+#include <unistd.h>
 #include <vector>
 
+extern "C" SEXP deparse1line(SEXP call, Rboolean abbrev);
+
 namespace rir {
 namespace pir {
 
@@ -117,6 +125,7 @@ class LowerFunctionLLVM {
     const std::unordered_map<Promise*, unsigned>& promMap;
     const NeedsRefcountAdjustment& refcount;
     const std::unordered_set<Instruction*>& needsLdVarForUpdate;
+    std::vector<SEXP>& callTargets;
     IRBuilder<> builder;
     MDBuilder MDB;
     LivenessIntervals liveness;
@@ -127,6 +136,7 @@ class LowerFunctionLLVM {
     llvm::Value* constantpool = nullptr;
     BasicBlock* entryBlock = nullptr;
     int inPushContext = 0;
+    bool contextsAreJumpTargets = true;
     std::unordered_set<Value*> escapesInlineContext;
 
     struct ContextData {
@@ -145,6 +155,53 @@ class LowerFunctionLLVM {
     MDNode* branchMostlyTrue;
     MDNode* branchMostlyFalse;
 
+    // Type based alias analysis. Every kind of memory the native code touches
+    // directly gets its own type, thus e.g. storing into the payload of a
+    // vector does not invalidate loaded lengths, attributes or the node stack.
+    // The payload type of a vector never changes while native code runs, so
+    // integer and real payloads cannot overlap either.
+    MDNode* tbaaRoot;
+    MDNode* tbaaSxpinfo;
+    MDNode* tbaaAttrib;
+    MDNode* tbaaLength;
+    MDNode* tbaaCell;
+    MDNode* tbaaInt;
+    MDNode* tbaaReal;
+    MDNode* tbaaVecElt;
+    MDNode* tbaaEnvStub;
+    MDNode* tbaaRirObject;
+    MDNode* tbaaNodeStack;
+    MDNode* tbaaNodeStackTop;
+    MDNode* tbaaGlobal;
+
+    MDNode* tbaaTag(const char* name) {
+        auto ty = MDB.createTBAAScalarTypeNode(name, tbaaRoot);
+        return MDB.createTBAAStructTagNode(ty, ty, 0);
+    }
+
+    template <typename Access>
+    Access* tbaa(Access* access, MDNode* tag) {
+        access->setMetadata(LLVMContext::MD_tbaa, tag);
+        return access;
+    }
+
+    // Line info mapping the native code to a listing of the PIR code, written
+    // to /tmp/rir-<pid>/ if PIR_JIT_DEBUG_INFO is set
+    std::unique_ptr<DIBuilder> DIB;
+    DISubprogram* debugScope = nullptr;
+    std::unordered_map<Instruction*, unsigned> listingLine;
+    void createDebugInfo();
+
+    MDNode* tbaaData(PirType type) {
+        if (type.isA(PirType(RType::integer).notObject()) ||
+            type.isA(PirType(RType::logical).notObject()))
+            return tbaaInt;
+        if (type.isA(PirType(RType::real).notObject()))
+            return tbaaReal;
+        assert(type.isA(PirType(RType::vec).notObject()));
+        return tbaaVecElt;
+    }
+
   public:
     llvm::Function* fun;
 
@@ -152,16 +209,28 @@ class LowerFunctionLLVM {
         const std::string& name, ClosureVersion* cls, Code* code,
         const std::unordered_map<Promise*, unsigned>& promMap,
         const NeedsRefcountAdjustment& refcount,
-        const std::unordered_set<Instruction*>& needsLdVarForUpdate)
+        const std::unordered_set<Instruction*>& needsLdVarForUpdate,
+        std::vector<SEXP>& callTargets)
         : cls(cls), code(code), promMap(promMap), refcount(refcount),
-          needsLdVarForUpdate(needsLdVarForUpdate), builder(C), MDB(C),
+          needsLdVarForUpdate(needsLdVarForUpdate), callTargets(callTargets),
+          builder(C), MDB(C),
           liveness(code, code->nextBBId), numLocals(0), numTemps(0),
           branchAlwaysTrue(MDB.createBranchWeights(100000000, 1)),
           branchAlwaysFalse(MDB.createBranchWeights(1, 100000000)),
           branchMostlyTrue(MDB.createBranchWeights(1000, 1)),
-          branchMostlyFalse(MDB.createBranchWeights(1, 1000)) {
+          branchMostlyFalse(MDB.createBranchWeights(1, 1000)),
+          tbaaRoot(MDB.createTBAARoot("rir")), tbaaSxpinfo(tbaaTag("sxpinfo")),
+          tbaaAttrib(tbaaTag("attrib")), tbaaLength(tbaaTag("length")),
+          tbaaCell(tbaaTag("cell")), tbaaInt(tbaaTag("int")),
+          tbaaReal(tbaaTag("real")), tbaaVecElt(tbaaTag("vecelt")),
+          tbaaEnvStub(tbaaTag("envstub")),
+          tbaaRirObject(tbaaTag("rirobject")),
+          tbaaNodeStack(tbaaTag("nodestack")),
+          tbaaNodeStackTop(tbaaTag("nodestacktop")),
+          tbaaGlobal(tbaaTag("global")) {
 
         fun = JitLLVM::declare(cls, name, t::nativeFunction);
+        contextsAreJumpTargets = cls->mayBeJumpTarget();
         // prevent Wunused
         this->cls->size();
         this->promMap.size();
@@ -186,6 +255,7 @@ class LowerFunctionLLVM {
             ImmutableLocalRVariable,
             MutablePrimitive,
             ImmutablePrimitive,
+            UnrootedRVariable,
         };
         Kind kind;
 
@@ -209,6 +279,14 @@ class LowerFunctionLLVM {
             return {ImmutableLocalRVariable, ptr, false};
         }
 
+        // A SEXP which is not on the node stack, i.e. the GC must not run
+        // while it is in use
+        static Variable Unrooted(Instruction* i) {
+            assert(i->producesRirResult());
+            assert(representationOf(i) == Representation::Sexp);
+            return {UnrootedRVariable, nullptr, false};
+        }
+
         static Variable Mutable(Instruction* i, AllocaInst* location) {
             assert(i->producesRirResult());
             auto r = representationOf(i);
@@ -233,6 +311,7 @@ class LowerFunctionLLVM {
             case MutablePrimitive:
                 return builder.CreateLoad(slot);
             case ImmutablePrimitive:
+            case UnrootedRVariable:
                 return slot;
             }
             assert(false);
@@ -250,6 +329,7 @@ class LowerFunctionLLVM {
                 break;
             case ImmutableLocalRVariable:
             case ImmutablePrimitive:
+            case UnrootedRVariable:
                 assert(false);
                 break;
             }
@@ -267,6 +347,7 @@ class LowerFunctionLLVM {
                 builder.CreateStore(val, slot, volatile_);
                 break;
             case ImmutablePrimitive:
+            case UnrootedRVariable:
                 slot = val;
                 break;
             }
@@ -401,6 +482,17 @@ class LowerFunctionLLVM {
                                         init);
     };
 
+    // Zero initialized storage for the dispatch cache of one call site
+    static llvm::Constant* callSiteCache() {
+        auto ty = llvm::ArrayType::get(
+            t::i64, (sizeof(CallSiteCache) + sizeof(uint64_t) - 1) /
+                        sizeof(uint64_t));
+        auto store = new llvm::GlobalVariable(
+            JitLLVM::module(), ty, false, llvm::GlobalValue::PrivateLinkage,
+            llvm::ConstantAggregateZero::get(ty));
+        return llvm::ConstantExpr::getPointerCast(store, t::voidPtr);
+    }
+
     llvm::AllocaInst* topAlloca(llvm::Type* t, size_t len = 1);
 
     llvm::Value* argument(int i);
@@ -507,7 +599,8 @@ class LowerFunctionLLVM {
 };
 
 void LowerFunctionLLVM::setVisible(int i) {
-    builder.CreateStore(c(i), convertToPointer(&R_Visible, t::IntPtr));
+    tbaa(builder.CreateStore(c(i), convertToPointer(&R_Visible, t::IntPtr)),
+         tbaaGlobal);
 }
 
 llvm::Value* LowerFunctionLLVM::force(Instruction* i, llvm::Value* arg) {
@@ -598,22 +691,22 @@ llvm::Value* LowerFunctionLLVM::constant(SEXP co, llvm::Type* needed) {
         return convertToPointer(co);
 
     auto i = Pool::insert(co);
-    llvm::Value* pos = builder.CreateLoad(constantpool);
+    llvm::Value* pos = tbaa(builder.CreateLoad(constantpool), tbaaGlobal);
     pos = builder.CreateBitCast(dataPtr(pos, false),
                                 PointerType::get(t::SEXP, 0));
     pos = builder.CreateGEP(pos, c(i));
-    auto res = builder.CreateLoad(pos);
+    auto res = tbaa(builder.CreateLoad(pos), tbaaVecElt);
     return res;
 }
 
 llvm::Value* LowerFunctionLLVM::nodestackPtr() {
-    return builder.CreateLoad(nodestackPtrAddr);
+    return tbaa(builder.CreateLoad(nodestackPtrAddr), tbaaNodeStackTop);
 }
 
 llvm::Value* LowerFunctionLLVM::stack(int i) {
     auto offset = -(i + 1);
     auto pos = builder.CreateGEP(nodestackPtr(), {c(offset), c(1)});
-    return builder.CreateLoad(t::SEXP, pos);
+    return tbaa(builder.CreateLoad(t::SEXP, pos), tbaaNodeStack);
 }
 
 void LowerFunctionLLVM::stack(const std::vector<llvm::Value*>& args) {
@@ -625,7 +718,7 @@ void LowerFunctionLLVM::stack(const std::vector<llvm::Value*>& args) {
     for (auto arg = args.begin(); arg != args.end(); arg++) {
         // store the value
         auto valS = builder.CreateGEP(stackptr, {c(pos), c(1)});
-        builder.CreateStore(*arg, valS);
+        tbaa(builder.CreateStore(*arg, valS), tbaaNodeStack);
         pos++;
     }
     assert(pos == 0);
@@ -635,13 +728,13 @@ void LowerFunctionLLVM::setLocal(size_t i, llvm::Value* v) {
     assert(i < numLocals);
     assert(v->getType() == t::SEXP);
     auto pos = builder.CreateGEP(basepointer, {c(i), c(1)});
-    builder.CreateStore(v, pos, true);
+    tbaa(builder.CreateStore(v, pos, true), tbaaNodeStack);
 }
 
 llvm::Value* LowerFunctionLLVM::getLocal(size_t i) {
     assert(i < numLocals);
     auto pos = builder.CreateGEP(basepointer, {c(i), c(1)});
-    return builder.CreateLoad(pos);
+    return tbaa(builder.CreateLoad(pos), tbaaNodeStack);
 }
 
 void LowerFunctionLLVM::incStack(int i, bool zero) {
@@ -652,7 +745,7 @@ void LowerFunctionLLVM::incStack(int i, bool zero) {
     if (zero)
         builder.CreateMemSet(cur, c(0, 8), offset, 1);
     auto up = builder.CreateGEP(cur, c(i));
-    builder.CreateStore(up, nodestackPtrAddr);
+    tbaa(builder.CreateStore(up, nodestackPtrAddr), tbaaNodeStackTop);
 }
 
 void LowerFunctionLLVM::decStack(int i) {
@@ -660,7 +753,7 @@ void LowerFunctionLLVM::decStack(int i) {
         return;
     auto cur = nodestackPtr();
     auto up = builder.CreateGEP(cur, c(-i));
-    builder.CreateStore(up, nodestackPtrAddr);
+    tbaa(builder.CreateStore(up, nodestackPtrAddr), tbaaNodeStackTop);
 }
 
 llvm::Value* LowerFunctionLLVM::callRBuiltin(SEXP builtin,
@@ -957,6 +1050,11 @@ void LowerFunctionLLVM::compilePushContext(Instruction* i) {
     auto& data = contexts[i];
     call(NativeBuiltins::initClosureContext, {ast, data.rcntxt, sysparent, op});
 
+    // Nothing can long-jump into the inlined context, thus we neither need
+    // the setjmp nor a copy of the live variables to restart from.
+    if (!contextsAreJumpTargets)
+        return;
+
     // Create a copy of all live variables to be able to restart
     // SEXPs are stored as local vars, primitive values are placed in an
     // alloca'd buffer
@@ -1009,8 +1107,10 @@ void LowerFunctionLLVM::compilePushContext(Instruction* i) {
     // Handle Incomming longjumps
     {
         builder.SetInsertPoint(didLongjmp);
-        llvm::Value* returned = builder.CreateLoad(
-            builder.CreateIntToPtr(c((void*)&R_ReturnedValue), t::SEXP_ptr));
+        llvm::Value* returned = tbaa(
+            builder.CreateLoad(builder.CreateIntToPtr(
+                c((void*)&R_ReturnedValue), t::SEXP_ptr)),
+            tbaaGlobal);
         auto restart =
             builder.CreateICmpEQ(returned, constant(R_RestartToken, t::SEXP));
 
@@ -1093,21 +1193,23 @@ llvm::Value* LowerFunctionLLVM::vectorPositionPtr(llvm::Value* vector,
 llvm::Value* LowerFunctionLLVM::accessVector(llvm::Value* vector,
                                              llvm::Value* position,
                                              PirType type) {
-    return builder.CreateLoad(vectorPositionPtr(vector, position, type));
+    return tbaa(builder.CreateLoad(vectorPositionPtr(vector, position, type)),
+                tbaaData(type));
 }
 
 llvm::Value* LowerFunctionLLVM::assignVector(llvm::Value* vector,
                                              llvm::Value* position,
                                              llvm::Value* value, PirType type) {
-    return builder.CreateStore(value,
-                               vectorPositionPtr(vector, position, type));
+    return tbaa(
+        builder.CreateStore(value, vectorPositionPtr(vector, position, type)),
+        tbaaData(type));
 }
 
 llvm::Value* LowerFunctionLLVM::unboxIntLgl(llvm::Value* v) {
     assert(v->getType() == t::SEXP);
     checkSexptype(v, {LGLSXP, INTSXP});
     auto pos = builder.CreateBitCast(dataPtr(v), t::IntPtr);
-    return builder.CreateLoad(pos);
+    return tbaa(builder.CreateLoad(pos), tbaaInt);
 }
 llvm::Value* LowerFunctionLLVM::unboxInt(llvm::Value* v) {
     assert(v->getType() == t::SEXP);
@@ -1116,7 +1218,7 @@ llvm::Value* LowerFunctionLLVM::unboxInt(llvm::Value* v) {
     insn_assert(isScalar(v), "expected scalar int");
 #endif
     auto pos = builder.CreateBitCast(dataPtr(v), t::IntPtr);
-    return builder.CreateLoad(pos);
+    return tbaa(builder.CreateLoad(pos), tbaaInt);
 }
 llvm::Value* LowerFunctionLLVM::unboxLgl(llvm::Value* v) {
     assert(v->getType() == t::SEXP);
@@ -1125,7 +1227,7 @@ llvm::Value* LowerFunctionLLVM::unboxLgl(llvm::Value* v) {
     insn_assert(isScalar(v), "expected scalar lgl");
 #endif
     auto pos = builder.CreateBitCast(dataPtr(v), t::IntPtr);
-    return builder.CreateLoad(pos);
+    return tbaa(builder.CreateLoad(pos), tbaaInt);
 }
 llvm::Value* LowerFunctionLLVM::unboxReal(llvm::Value* v) {
     assert(v->getType() == t::SEXP);
@@ -1134,7 +1236,7 @@ llvm::Value* LowerFunctionLLVM::unboxReal(llvm::Value* v) {
     insn_assert(isScalar(v), "expected scalar real");
 #endif
     auto pos = builder.CreateBitCast(dataPtr(v), t::DoublePtr);
-    auto res = builder.CreateLoad(pos);
+    auto res = tbaa(builder.CreateLoad(pos), tbaaReal);
     return res;
 }
 llvm::Value* LowerFunctionLLVM::unboxRealIntLgl(llvm::Value* v) {
@@ -1174,7 +1276,7 @@ llvm::Value* LowerFunctionLLVM::unboxRealIntLgl(llvm::Value* v) {
 llvm::Value* LowerFunctionLLVM::argument(int i) {
     auto pos = builder.CreateGEP(paramArgs(), c(i));
     pos = builder.CreateGEP(pos, {c(0), c(1)});
-    return builder.CreateLoad(t::SEXP, pos);
+    return tbaa(builder.CreateLoad(t::SEXP, pos), tbaaNodeStack);
 }
 
 AllocaInst* LowerFunctionLLVM::topAlloca(llvm::Type* t, size_t len) {
@@ -1232,7 +1334,8 @@ llvm::Value* LowerFunctionLLVM::isExternalsxp(llvm::Value* v, uint32_t magic) {
     auto isExternalsxp = builder.CreateICmpEQ(c(EXTERNALSXP), sexptype(v));
     auto es = builder.CreateBitCast(dataPtr(v, false),
                                     PointerType::get(t::RirRuntimeObject, 0));
-    auto magicVal = builder.CreateLoad(builder.CreateGEP(es, {c(0), c(2)}));
+    auto magicVal = tbaa(builder.CreateLoad(builder.CreateGEP(es, {c(0), c(2)})),
+                         tbaaRirObject);
     auto isCorrectMagic = builder.CreateICmpEQ(magicVal, c(magic));
     return builder.CreateAnd(isExternalsxp, isCorrectMagic);
 }
@@ -1281,29 +1384,29 @@ llvm::Value* LowerFunctionLLVM::sxpinfoPtr(llvm::Value* v) {
 
 void LowerFunctionLLVM::setSexptype(llvm::Value* v, int t) {
     auto ptr = sxpinfoPtr(v);
-    llvm::Value* sxpinfo = builder.CreateLoad(ptr);
+    llvm::Value* sxpinfo = tbaa(builder.CreateLoad(ptr), tbaaSxpinfo);
     sxpinfo =
         builder.CreateAnd(sxpinfo, c(~((unsigned long)(MAX_NUM_SEXPTYPE - 1))));
     sxpinfo = builder.CreateOr(sxpinfo, c(t, 64));
-    builder.CreateStore(sxpinfo, ptr);
+    tbaa(builder.CreateStore(sxpinfo, ptr), tbaaSxpinfo);
 }
 
 llvm::Value* LowerFunctionLLVM::sexptype(llvm::Value* v) {
-    auto sxpinfo = builder.CreateLoad(sxpinfoPtr(v));
+    auto sxpinfo = tbaa(builder.CreateLoad(sxpinfoPtr(v)), tbaaSxpinfo);
     auto t = builder.CreateAnd(sxpinfo, c(MAX_NUM_SEXPTYPE - 1, 64));
     return builder.CreateTrunc(t, t::Int);
 }
 
 llvm::Value* LowerFunctionLLVM::tag(llvm::Value* v) {
     auto pos = builder.CreateGEP(v, {c(0), c(4), c(2)});
-    return builder.CreateLoad(pos);
+    return tbaa(builder.CreateLoad(pos), tbaaCell);
 }
 
 void LowerFunctionLLVM::setCar(llvm::Value* x, llvm::Value* y,
                                bool needsWriteBarrier) {
     auto fast = [&]() {
         auto xx = builder.CreateGEP(x, {c(0), c(4), c(0)});
-        builder.CreateStore(y, xx);
+        tbaa(builder.CreateStore(y, xx), tbaaCell);
     };
     if (!needsWriteBarrier) {
         fast();
@@ -1316,7 +1419,7 @@ void LowerFunctionLLVM::setCdr(llvm::Value* x, llvm::Value* y,
                                bool needsWriteBarrier) {
     auto fast = [&]() {
         auto xx = builder.CreateGEP(x, {c(0), c(4), c(1)});
-        builder.CreateStore(y, xx);
+        tbaa(builder.CreateStore(y, xx), tbaaCell);
     };
     if (!needsWriteBarrier) {
         fast();
@@ -1329,7 +1432,7 @@ void LowerFunctionLLVM::setTag(llvm::Value* x, llvm::Value* y,
                                bool needsWriteBarrier) {
     auto fast = [&]() {
         auto xx = builder.CreateGEP(x, {c(0), c(4), c(2)});
-        builder.CreateStore(y, xx);
+        tbaa(builder.CreateStore(y, xx), tbaaCell);
     };
     if (!needsWriteBarrier) {
         fast();
@@ -1340,28 +1443,28 @@ void LowerFunctionLLVM::setTag(llvm::Value* x, llvm::Value* y,
 
 llvm::Value* LowerFunctionLLVM::car(llvm::Value* v) {
     v = builder.CreateGEP(v, {c(0), c(4), c(0)});
-    return builder.CreateLoad(v);
+    return tbaa(builder.CreateLoad(v), tbaaCell);
 }
 
 llvm::Value* LowerFunctionLLVM::cdr(llvm::Value* v) {
     v = builder.CreateGEP(v, {c(0), c(4), c(1)});
-    return builder.CreateLoad(v);
+    return tbaa(builder.CreateLoad(v), tbaaCell);
 }
 
 llvm::Value* LowerFunctionLLVM::attr(llvm::Value* v) {
     auto pos = builder.CreateGEP(v, {c(0), c(1)});
-    return builder.CreateLoad(pos);
+    return tbaa(builder.CreateLoad(pos), tbaaAttrib);
 }
 
 llvm::Value* LowerFunctionLLVM::isScalar(llvm::Value* v) {
     auto va = builder.CreateBitCast(v, t::VECTOR_SEXPREC_ptr);
     auto lp = builder.CreateGEP(va, {c(0), c(4), c(0)});
-    auto l = builder.CreateLoad(lp);
+    auto l = tbaa(builder.CreateLoad(lp), tbaaLength);
     return builder.CreateICmpEQ(l, c(1, 64));
 }
 
 llvm::Value* LowerFunctionLLVM::isSimpleScalar(llvm::Value* v, SEXPTYPE t) {
-    auto sxpinfo = builder.CreateLoad(sxpinfoPtr(v));
+    auto sxpinfo = tbaa(builder.CreateLoad(sxpinfoPtr(v)), tbaaSxpinfo);
 
     auto type = builder.CreateAnd(sxpinfo, c(MAX_NUM_SEXPTYPE - 1, 64));
     auto okType = builder.CreateICmpEQ(c(t), builder.CreateTrunc(type, t::Int));
@@ -1380,12 +1483,12 @@ llvm::Value* LowerFunctionLLVM::vectorLength(llvm::Value* v) {
     assert(v->getType() == t::SEXP);
     auto pos = builder.CreateBitCast(v, t::VECTOR_SEXPREC_ptr);
     pos = builder.CreateGEP(pos, {c(0), c(4), c(0)});
-    return builder.CreateLoad(pos);
+    return tbaa(builder.CreateLoad(pos), tbaaLength);
 }
 void LowerFunctionLLVM::assertNamed(llvm::Value* v) {
     assert(v->getType() == t::SEXP);
     auto sxpinfoP = builder.CreateBitCast(sxpinfoPtr(v), t::i64ptr);
-    auto sxpinfo = builder.CreateLoad(sxpinfoP);
+    auto sxpinfo = tbaa(builder.CreateLoad(sxpinfoP), tbaaSxpinfo);
 
     static auto namedMask = ((unsigned long)pow(2, NAMED_BITS) - 1) << 32;
     auto named = builder.CreateAnd(sxpinfo, c(namedMask));
@@ -1406,7 +1509,7 @@ void LowerFunctionLLVM::assertNamed(llvm::Value* v) {
 llvm::Value* LowerFunctionLLVM::shared(llvm::Value* v) {
     assert(v->getType() == t::SEXP);
     auto sxpinfoP = builder.CreateBitCast(sxpinfoPtr(v), t::i64ptr);
-    auto sxpinfo = builder.CreateLoad(sxpinfoP);
+    auto sxpinfo = tbaa(builder.CreateLoad(sxpinfoP), tbaaSxpinfo);
 
     static auto namedMask = ((unsigned long)pow(2, NAMED_BITS) - 1);
     auto named = builder.CreateLShr(sxpinfo, c(32ul));
@@ -1417,7 +1520,7 @@ llvm::Value* LowerFunctionLLVM::shared(llvm::Value* v) {
 void LowerFunctionLLVM::ensureNamed(llvm::Value* v) {
     assert(v->getType() == t::SEXP);
     auto sxpinfoP = builder.CreateBitCast(sxpinfoPtr(v), t::i64ptr);
-    auto sxpinfo = builder.CreateLoad(sxpinfoP);
+    auto sxpinfo = tbaa(builder.CreateLoad(sxpinfoP), tbaaSxpinfo);
 
     static auto namedMask = ((unsigned long)pow(2, NAMED_BITS) - 1) << 32;
     unsigned long namedLSB = 1ul << 32;
@@ -1432,7 +1535,7 @@ void LowerFunctionLLVM::ensureNamed(llvm::Value* v) {
 
     builder.SetInsertPoint(notNamed);
     auto namedSxpinfo = builder.CreateOr(sxpinfo, c(namedLSB));
-    builder.CreateStore(namedSxpinfo, sxpinfoP);
+    tbaa(builder.CreateStore(namedSxpinfo, sxpinfoP), tbaaSxpinfo);
     builder.CreateBr(ok);
 
     builder.SetInsertPoint(ok);
@@ -1441,7 +1544,7 @@ void LowerFunctionLLVM::ensureNamed(llvm::Value* v) {
 void LowerFunctionLLVM::ensureShared(llvm::Value* v) {
     assert(v->getType() == t::SEXP);
     auto sxpinfoP = sxpinfoPtr(v);
-    auto sxpinfo = builder.CreateLoad(sxpinfoP);
+    auto sxpinfo = tbaa(builder.CreateLoad(sxpinfoP), tbaaSxpinfo);
 
     static auto namedMask = ((unsigned long)pow(2, NAMED_BITS) - 1);
     static auto namedNegMask = ~(namedMask << 32);
@@ -1461,7 +1564,7 @@ void LowerFunctionLLVM::ensureShared(llvm::Value* v) {
 
     auto newSxpinfo = builder.CreateAnd(sxpinfo, c(namedNegMask));
     newSxpinfo = builder.CreateOr(newSxpinfo, newNamed);
-    builder.CreateStore(newSxpinfo, sxpinfoP);
+    tbaa(builder.CreateStore(newSxpinfo, sxpinfoP), tbaaSxpinfo);
     builder.CreateBr(done);
 
     builder.SetInsertPoint(done);
@@ -1470,7 +1573,7 @@ void LowerFunctionLLVM::ensureShared(llvm::Value* v) {
 void LowerFunctionLLVM::incrementNamed(llvm::Value* v, int max) {
     assert(v->getType() == t::SEXP);
     auto sxpinfoP = sxpinfoPtr(v);
-    auto sxpinfo = builder.CreateLoad(sxpinfoP);
+    auto sxpinfo = tbaa(builder.CreateLoad(sxpinfoP), tbaaSxpinfo);
 
     static auto namedMask = ((unsigned long)pow(2, NAMED_BITS) - 1);
     static auto namedNegMask = ~(namedMask << 32);
@@ -1491,7 +1594,7 @@ void LowerFunctionLLVM::incrementNamed(llvm::Value* v, int max) {
 
     auto newSxpinfo = builder.CreateAnd(sxpinfo, c(namedNegMask));
     newSxpinfo = builder.CreateOr(newSxpinfo, newNamed);
-    builder.CreateStore(newSxpinfo, sxpinfoP);
+    tbaa(builder.CreateStore(newSxpinfo, sxpinfoP), tbaaSxpinfo);
     builder.CreateBr(done);
 
     builder.SetInsertPoint(done);
@@ -1699,13 +1802,18 @@ void LowerFunctionLLVM::compileBinop(
         auto a = loadSxp(lhs);
         auto b = loadSxp(rhs);
 
+        // x <- x op y can update x in place
+        bool inPlace = refcount.overwritesVariable.count(i);
         llvm::Value* res = nullptr;
         if (i->hasEnv()) {
             auto e = loadSxp(i->env());
-            res = call(NativeBuiltins::binopEnv,
+            res = call(inPlace ? NativeBuiltins::binopEnvInPlace
+                               : NativeBuiltins::binopEnv,
                        {a, b, e, c(i->srcIdx), c((int)kind)});
         } else {
-            res = call(NativeBuiltins::binop, {a, b, c((int)kind)});
+            res = call(inPlace ? NativeBuiltins::binopInPlace
+                               : NativeBuiltins::binop,
+                       {a, b, c((int)kind)});
         }
 
         setVal(i, res);
@@ -1832,7 +1940,7 @@ void LowerFunctionLLVM::compileUnop(
 void LowerFunctionLLVM::writeBarrier(llvm::Value* x, llvm::Value* y,
                                      std::function<void()> no,
                                      std::function<void()> yes) {
-    auto sxpinfoX = builder.CreateLoad(sxpinfoPtr(x));
+    auto sxpinfoX = tbaa(builder.CreateLoad(sxpinfoPtr(x)), tbaaSxpinfo);
 
     auto markBitPos = c((unsigned long)(1ul << (TYPE_BITS + 19)));
     auto genBitPos = c((unsigned long)(1ul << (TYPE_BITS + 23)));
@@ -1848,7 +1956,7 @@ void LowerFunctionLLVM::writeBarrier(llvm::Value* x, llvm::Value* y,
     builder.CreateCondBr(markBitX, maybeNeedsBarrier, noBarrier);
 
     builder.SetInsertPoint(maybeNeedsBarrier);
-    auto sxpinfoY = builder.CreateLoad(sxpinfoPtr(y));
+    auto sxpinfoY = tbaa(builder.CreateLoad(sxpinfoPtr(y)), tbaaSxpinfo);
     auto markBitY =
         builder.CreateICmpNE(builder.CreateAnd(sxpinfoY, markBitPos), c(0, 64));
     builder.CreateCondBr(markBitY, maybeNeedsBarrier2, needsBarrier);
@@ -1911,6 +2019,7 @@ bool LowerFunctionLLVM::compileDotcall(
                                    c(calli->nCallArgs()),
                                    builder.CreateBitCast(namesStore, t::IntPtr),
                                    c(asmpt.toI()),
+                                   callSiteCache(),
                                });
                },
                /* dotCall pops arguments : */ false));
@@ -1931,7 +2040,7 @@ llvm::Value* LowerFunctionLLVM::envStubGet(llvm::Value* x, int i, size_t size) {
     auto payload = builder.CreateBitCast(
         builder.CreateGEP(missingBits, c(size)), t::SEXP_ptr);
     auto pos = builder.CreateGEP(payload, c(i + LazyEnvironment::ArgOffset));
-    return builder.CreateLoad(pos);
+    return tbaa(builder.CreateLoad(pos), tbaaEnvStub);
 }
 
 void LowerFunctionLLVM::envStubSetNotMissing(llvm::Value* x, int i) {
@@ -1940,7 +2049,7 @@ void LowerFunctionLLVM::envStubSetNotMissing(llvm::Value* x, int i) {
     auto missingBits =
         builder.CreateBitCast(builder.CreateGEP(le, c(1)), t::i8ptr);
     auto pos = builder.CreateGEP(missingBits, c(i));
-    builder.CreateStore(c(1, 8), pos);
+    tbaa(builder.CreateStore(c(1, 8), pos), tbaaEnvStub);
 }
 
 void LowerFunctionLLVM::envStubSet(llvm::Value* x, int i, llvm::Value* y,
@@ -1962,7 +2071,7 @@ void LowerFunctionLLVM::envStubSet(llvm::Value* x, int i, llvm::Value* y,
                 builder.CreateGEP(missingBits, c(size)), t::SEXP_ptr);
             auto pos =
                 builder.CreateGEP(payload, c(i + LazyEnvironment::ArgOffset));
-            builder.CreateStore(y, pos);
+            tbaa(builder.CreateStore(y, pos), tbaaEnvStub);
         },
         [&]() {
             call(NativeBuiltins::externalsxpSetEntry,
@@ -1974,13 +2083,13 @@ void LowerFunctionLLVM::envStubSet(llvm::Value* x, int i, llvm::Value* y,
         auto missingBits =
             builder.CreateBitCast(builder.CreateGEP(le, c(1)), t::i8ptr);
         auto pos = builder.CreateGEP(missingBits, c(i));
-        builder.CreateStore(c(1, 8), pos);
+        tbaa(builder.CreateStore(c(1, 8), pos), tbaaEnvStub);
     }
 }
 
 llvm::Value* LowerFunctionLLVM::isObj(llvm::Value* v) {
     checkIsSexp(v, "in IsObj");
-    auto sxpinfo = builder.CreateLoad(sxpinfoPtr(v));
+    auto sxpinfo = tbaa(builder.CreateLoad(sxpinfoPtr(v)), tbaaSxpinfo);
     return builder.CreateICmpNE(
         c(0, 64),
         builder.CreateAnd(sxpinfo, c((unsigned long)(1ul << (TYPE_BITS + 1)))));
@@ -2000,7 +2109,7 @@ llvm::Value* LowerFunctionLLVM::fastVeceltOkNative(llvm::Value* v) {
 
 llvm::Value* LowerFunctionLLVM::isAltrep(llvm::Value* v) {
     checkIsSexp(v, "in is altrep");
-    auto sxpinfo = builder.CreateLoad(sxpinfoPtr(v));
+    auto sxpinfo = tbaa(builder.CreateLoad(sxpinfoPtr(v)), tbaaSxpinfo);
     return builder.CreateICmpNE(
         c(0, 64),
         builder.CreateAnd(sxpinfo, c((unsigned long)(1ul << (TYPE_BITS + 2)))));
@@ -2011,6 +2120,56 @@ bool LowerFunctionLLVM::tryInlineBuiltin(int builtin) {
     return false;
 };
 
+void LowerFunctionLLVM::createDebugInfo() {
+    if (!Parameter::JIT_DEBUG_INFO)
+        return;
+
+    auto dir = "/tmp/rir-" + std::to_string(getpid());
+    mkdir(dir.c_str(), 0755);
+    auto name = fun->getName().str() + ".pir";
+    std::ofstream listing(dir + "/" + name);
+    if (!listing)
+        return;
+
+    // One line per instruction, followed by the R source it stems from
+    unsigned line = 1;
+    Visitor::run(code->entry, [&](BB* bb) {
+        listing << "BB" << bb->id << "\n";
+        line++;
+        for (auto i : *bb) {
+            std::stringstream instr;
+            i->print(instr, false);
+            auto str = instr.str();
+            std::replace(str.begin(), str.end(), '\n', ' ');
+            listing << "  " << str;
+            if (i->srcIdx) {
+                auto src = src_pool_at(globalContext(), i->srcIdx);
+                std::string deparsed =
+                    CHAR(STRING_ELT(deparse1line(src, FALSE), 0));
+                if (deparsed.size() > 80)
+                    deparsed = deparsed.substr(0, 77) + "...";
+                listing << "  # " << deparsed;
+            }
+            listing << "\n";
+            listingLine[i] = line++;
+        }
+    });
+
+    auto& module = JitLLVM::module();
+    module.addModuleFlag(Module::Warning, "Debug Info Version",
+                         DEBUG_METADATA_VERSION);
+    DIB.reset(new DIBuilder(module));
+    auto file = DIB->createFile(name, dir);
+    DIB->createCompileUnit(dwarf::DW_LANG_C, file, "rir", true, "", 0);
+    auto type = DIB->createSubroutineType(DIB->getOrCreateTypeArray({}));
+    debugScope = DIB->createFunction(
+        file, fun->getName(), fun->getName(), file, 1, type, 1,
+        DINode::FlagPrototyped,
+        DISubprogram::SPFlagDefinition | DISubprogram::SPFlagOptimized);
+    fun->setSubprogram(debugScope);
+    builder.SetCurrentDebugLocation(DebugLoc::get(1, 0, debugScope));
+}
+
 bool LowerFunctionLLVM::tryCompile() {
     std::unordered_map<BB*, BasicBlock*> blockMapping_;
     auto getBlock = [&](BB* bb) {
@@ -2024,6 +2183,7 @@ bool LowerFunctionLLVM::tryCompile() {
     };
     entryBlock = BasicBlock::Create(C, "", fun);
     builder.SetInsertPoint(entryBlock);
+    createDebugInfo();
     nodestackPtrAddr = convertToPointer(&R_BCNodeStackTop,
                                         PointerType::get(t::stackCellPtr, 0));
     {
@@ -2058,13 +2218,47 @@ bool LowerFunctionLLVM::tryCompile() {
             return v->producesRirResult() && !LdConst::Cast(v) &&
                    !CastType::Cast(v);
         };
+        // Immutable SEXPs share node stack slots if they are not live at the
+        // same time. Thus, at every call the node stack holds exactly the
+        // live values, and the frame needs fewer slots to be cleared.
+        // Casts are loaded from the slot of the value they cast, so they
+        // keep it alive too.
+        std::unordered_map<Value*, std::vector<Value*>> aliases;
+        Visitor::run(code->entry, [&](Instruction* i) {
+            if (liveness.count(i))
+                aliases[i->followCasts()].push_back(i);
+        });
+        auto interfere = [&](Instruction* a, Instruction* b) {
+            for (auto x : aliases[a])
+                for (auto y : aliases[b])
+                    if (liveness.interfere(x, y))
+                        return true;
+            return false;
+        };
+        std::vector<std::pair<size_t, std::vector<Instruction*>>> sharedSlots;
+        auto rootSlot = [&](Instruction* i) {
+            // Values which are never used are not in the liveness intervals
+            if (!liveness.live(i, i))
+                return numLocals++;
+            for (auto& slot : sharedSlots) {
+                auto& values = slot.second;
+                if (std::none_of(
+                        values.begin(), values.end(),
+                        [&](Instruction* j) { return interfere(i, j); })) {
+                    values.push_back(i);
+                    return slot.first;
+                }
+            }
+            sharedSlots.push_back({numLocals, {i}});
+            return numLocals++;
+        };
         auto createVariable = [&](Instruction* i, bool mut) {
             if (representationOf(i) == Representation::Sexp) {
                 if (mut)
                     variables[i] = Variable::MutableRVariable(
                         i, numLocals++, builder, basepointer);
                 else
-                    variables[i] = Variable::RVariable(i, numLocals++, builder,
+                    variables[i] = Variable::RVariable(i, rootSlot(i), builder,
                                                        basepointer);
             } else {
                 if (mut)
@@ -2075,6 +2269,8 @@ bool LowerFunctionLLVM::tryCompile() {
             }
         };
 
+        // Arguments on the node stack are only read while the function runs
+        fun->addParamAttr(1, Attribute::NoAlias);
         auto arg = fun->arg_begin();
         for (size_t i = 0; i < argNames.size(); ++i) {
             args.push_back(arg);
@@ -2124,9 +2320,53 @@ bool LowerFunctionLLVM::tryCompile() {
                 });
             }
         });
+
+        // A SEXP which is consumed right away by an instruction that cannot
+        // trigger the GC can stay in a register
+        std::unordered_map<Value*, std::vector<Instruction*>> uses;
+        Visitor::run(code->entry, [&](Instruction* i) {
+            if (!CastType::Cast(i))
+                i->eachArg(
+                    [&](Value* v) { uses[v->followCasts()].push_back(i); });
+        });
+        auto unrooted = [&](Instruction* i) {
+            if (representationOf(i) != Representation::Sexp || phis.count(i))
+                return false;
+            auto& u = uses[i];
+            if (u.size() != 1 || u[0]->bb() != i->bb())
+                return false;
+            auto use = u[0];
+            switch (use->tag) {
+            case Tag::Return:
+            case Tag::IsType:
+                break;
+            case Tag::StVar: {
+                auto env = MkEnv::Cast(use->env());
+                if (!env || !env->stub)
+                    return false;
+                break;
+            }
+            default:
+                return false;
+            }
+            bool ok = true;
+            use->eachArg([&](Value* v) {
+                if (representationOf(v) != Representation::Sexp)
+                    ok = false;
+            });
+            auto bb = i->bb();
+            for (auto j = bb->indexOf(i) + 1; j < bb->indexOf(use); ++j)
+                if (!CastType::Cast(bb->at(j)))
+                    ok = false;
+            return ok;
+        };
         Visitor::run(code->entry, [&](Instruction* i) {
-            if (needsVariable(i) && !variables.count(i))
-                createVariable(i, false);
+            if (needsVariable(i) && !variables.count(i)) {
+                if (unrooted(i))
+                    variables[i] = Variable::Unrooted(i);
+                else
+                    createVariable(i, false);
+            }
         });
     }
 
@@ -2149,6 +2389,10 @@ bool LowerFunctionLLVM::tryCompile() {
             if (!success)
                 return;
 
+            if (debugScope)
+                builder.SetCurrentDebugLocation(
+                    DebugLoc::get(listingLine.at(i), 0, debugScope));
+
             auto needsAdjust = refcount.beforeUse.find(i);
             if (needsAdjust != refcount.beforeUse.end()) {
                 for (auto& adjust : needsAdjust->second) {
@@ -2804,7 +3048,8 @@ bool LowerFunctionLLVM::tryCompile() {
                            return call(NativeBuiltins::call,
                                        {paramCode(), c(b->srcIdx),
                                         loadSxp(b->cls()), loadSxp(b->env()),
-                                        c(b->nCallArgs()), c(asmpt.toI())});
+                                        c(b->nCallArgs()), c(asmpt.toI()),
+                                        callSiteCache()});
                        }));
                 break;
             }
@@ -2836,6 +3081,7 @@ bool LowerFunctionLLVM::tryCompile() {
                                    c(b->nCallArgs()),
                                    builder.CreateBitCast(namesStore, t::IntPtr),
                                    c(asmpt.toI()),
+                                   callSiteCache(),
                                });
                        }));
                 break;
@@ -2857,7 +3103,7 @@ bool LowerFunctionLLVM::tryCompile() {
                                             loadSxp(calli->runtimeClosure()),
                                             loadSxp(calli->env()),
                                             c(calli->nCallArgs()),
-                                            c(asmpt.toI())});
+                                            c(asmpt.toI()), callSiteCache()});
                            }));
                     break;
                 }
@@ -2876,30 +3122,12 @@ bool LowerFunctionLLVM::tryCompile() {
                         }
                     }
                     if (nativeTarget) {
-                        llvm::Value* trg = JitLLVM::get(target);
-                        auto nativeCode = nativeTarget->body()->nativeCode;
-                        if (!trg && nativeCode) {
-                            trg = builder.CreateIntToPtr(c((void*)nativeCode),
-                                                         t::nativeFunctionPtr);
-                        }
-                        if (trg &&
-                            target->properties.includes(
-                                ClosureVersion::Property::NoReflection)) {
-                            auto code = builder.CreateIntToPtr(
-                                c(nativeTarget->body()), t::voidPtr);
-                            llvm::Value* arglist = nodestackPtr();
-                            auto rr = withCallFrame(args, [&]() {
-                                return builder.CreateCall(
-                                    trg, {code, arglist, loadSxp(i->env()),
-                                          constant(callee, t::SEXP)});
-                            });
-                            setVal(i, rr);
-                            break;
-                        }
-
-                        assert(
-                            asmpt.includes(Assumption::StaticallyArgmatched));
-                        auto res = withCallFrame(args, [&]() {
+                        // Both the trampoline and the direct call refer to
+                        // the version, which might be dropped from its
+                        // dispatch table in the meantime
+                        callTargets.push_back(nativeTarget->container());
+                        auto body = nativeTarget->body();
+                        auto trampoline = [&]() {
                             return call(NativeBuiltins::nativeCallTrampoline,
                                         {
                                             constant(callee, t::SEXP),
@@ -2910,8 +3138,92 @@ bool LowerFunctionLLVM::tryCompile() {
                                             c(args.size()),
                                             c(asmpt.toI()),
                                         });
-                        });
-                        setVal(i, res);
+                        };
+
+                        // Callees which don't need a context and take all
+                        // arguments as passed are called directly
+                        bool direct =
+                            target->properties.includes(
+                                ClosureVersion::Property::NoReflection) &&
+                            !nativeTarget->signature().jumpTarget &&
+                            nativeTarget->signature().numArguments ==
+                                args.size();
+                        if (!direct) {
+                            assert(asmpt.includes(
+                                Assumption::StaticallyArgmatched));
+                            setVal(i, withCallFrame(args, trampoline));
+                            break;
+                        }
+
+                        llvm::Value* code =
+                            builder.CreateIntToPtr(c(body), t::voidPtr);
+                        auto env = loadSxp(i->env());
+
+                        // The native code slot of the callee's body acts as a
+                        // patchable entry guard. It is cleared when the
+                        // version dies or deoptimizes, then the trampoline
+                        // falls back to a generic call. Thus no caller enters
+                        // a deoptimized version again.
+                        llvm::Value* slot = convertToPointer(
+                            (void*)&body->nativeCode,
+                            PointerType::get(t::nativeFunctionPtr, 0));
+
+                        // The only function in this module is the one being
+                        // compiled, i.e. this is a recursive call. The new
+                        // version is not installed yet and nativeTarget is
+                        // the version it replaces, which gets killed once it
+                        // is. The version is called directly, with its own
+                        // code object and guarded by its own slot. Promises
+                        // are lowered under the same key, thus only the body
+                        // can call itself like this.
+                        auto direct = this->code == cls
+                                          ? JitLLVM::get(target)
+                                          : nullptr;
+                        if (direct) {
+                            code = paramCode();
+                            auto offset = (uintptr_t)&body->nativeCode -
+                                          (uintptr_t)body;
+                            slot = builder.CreateBitCast(
+                                builder.CreateGEP(
+                                    builder.CreateBitCast(code, t::i8ptr),
+                                    c(offset)),
+                                PointerType::get(t::nativeFunctionPtr, 0));
+                        }
+                        setVal(i, withCallFrame(args, [&]() -> llvm::Value* {
+                                   auto trg = tbaa(builder.CreateLoad(slot),
+                                                   tbaaRirObject);
+                                   auto fast = BasicBlock::Create(C, "", fun);
+                                   auto slow = BasicBlock::Create(C, "", fun);
+                                   auto done = BasicBlock::Create(C, "", fun);
+                                   builder.CreateCondBr(
+                                       builder.CreateIsNull(trg), slow, fast,
+                                       branchMostlyFalse);
+
+                                   builder.SetInsertPoint(fast);
+                                   auto res1 =
+                                       direct
+                                           ? builder.CreateCall(
+                                                 direct,
+                                                 {code, nodestackPtr(), env,
+                                                  constant(callee, t::SEXP)})
+                                           : builder.CreateCall(
+                                                 trg,
+                                                 {code, nodestackPtr(), env,
+                                                  constant(callee, t::SEXP)});
+                                   fast = builder.GetInsertBlock();
+                                   builder.CreateBr(done);
+
+                                   builder.SetInsertPoint(slow);
+                                   auto res2 = trampoline();
+                                   slow = builder.GetInsertBlock();
+                                   builder.CreateBr(done);
+
+                                   builder.SetInsertPoint(done);
+                                   auto res = builder.CreatePHI(t::SEXP, 2);
+                                   res->addIncoming(res1, fast);
+                                   res->addIncoming(res2, slow);
+                                   return res;
+                               }));
                         break;
                     }
                 }
@@ -2928,6 +3240,7 @@ bool LowerFunctionLLVM::tryCompile() {
                                    loadSxp(calli->env()),
                                    c(calli->nCallArgs()),
                                    c(asmpt.toI()),
+                                   callSiteCache(),
                                });
                        }));
                 break;
@@ -3006,10 +3319,14 @@ bool LowerFunctionLLVM::tryCompile() {
                 auto t = bb->trueBranch();
                 auto f = bb->falseBranch();
                 MDNode* weight = nullptr;
+                auto& feedback = Branch::Cast(i)->feedback;
                 if (t->isDeopt() || (t->isJmp() && t->next()->isDeopt()))
                     weight = branchAlwaysFalse;
                 else if (f->isDeopt() || (f->isJmp() && f->next()->isDeopt()))
                     weight = branchAlwaysTrue;
+                else if (feedback.seen == ObservedTest::Both)
+                    weight = MDB.createBranchWeights(feedback.trueCount + 1,
+                                                     feedback.falseCount + 1);
                 builder.CreateCondBr(cond, getBlock(bb->trueBranch()),
                                      getBlock(bb->falseBranch()), weight);
                 break;
@@ -4567,7 +4884,8 @@ bool LowerFunctionLLVM::tryCompile() {
                         builder.SetInsertPoint(fastcase);
                         auto store =
                             vectorPositionPtr(cur, c(0), st->val()->type);
-                        builder.CreateStore(load(st->val()), store);
+                        tbaa(builder.CreateStore(load(st->val()), store),
+                             tbaaData(st->val()->type));
                         builder.CreateBr(done);
 
                         builder.SetInsertPoint(fallback);
@@ -4818,6 +5136,9 @@ bool LowerFunctionLLVM::tryCompile() {
     builder.SetInsertPoint(entryBlock);
     builder.CreateBr(getBlock(code->entry));
 
+    if (DIB)
+        DIB->finalize();
+
     if (success) {
         // outs() << "Compiled " << fun->getName() << "\n";
         // fun->dump();
@@ -4843,12 +5164,33 @@ void* LowerLLVM::tryCompile(
     JitLLVM::createModule();
     auto mangledName = JitLLVM::mangle(cls->name());
     LowerFunctionLLVM funCompiler(mangledName, cls, code, m, refcount,
-                                  needsLdVarForUpdate);
+                                  needsLdVarForUpdate, callTargets);
     if (!funCompiler.tryCompile())
         return nullptr;
 
     return JitLLVM::tryCompile(funCompiler.fun);
 }
 
+// R does not run destructors of the objects embedded in its vectors. Code
+// with native code owns a handle with a finalizer instead, which frees the
+// module. Only the code references the handle, thus it becomes unreachable
+// together with the code. Code without native code has nothing to free and
+// no handle, which spares the GC a finalizer per code object.
+static void releaseNative(SEXP handle) {
+    if (auto native = R_ExternalPtrAddr(handle)) {
+        R_ClearExternalPtr(handle);
+        JitLLVM::release(native);
+    }
+}
+
+void LowerLLVM::attach(rir::Code* code, void* native) {
+    SEXP handle = PROTECT(R_MakeExternalPtr(native, R_NilValue, R_NilValue));
+    R_RegisterCFinalizerEx(handle, releaseNative, FALSE);
+    code->addExtraPoolEntry(handle);
+    for (auto target : callTargets)
+        code->addExtraPoolEntry(target);
+    UNPROTECT(1);
+}
+
 } // namespace pir
 } // namespace rir
@@ -12,12 +12,20 @@ namespace rir {
 namespace pir {
 
 class LowerLLVM {
+    // Versions the native code calls directly, they have to live as long as
+    // the code calling them
+    std::vector<SEXP> callTargets;
+
   public:
     void*
     tryCompile(ClosureVersion* cls, Code* code,
                const std::unordered_map<Promise*, unsigned>&,
                const NeedsRefcountAdjustment& refcount,
                const std::unordered_set<Instruction*>& needsLdVarForUpdate);
+
+    // Ties the lifetime of native code and its call targets to the rir code
+    // object running it, the module is freed once the code object is collected
+    void attach(rir::Code* code, void* native);
 };
 
 } // namespace pir
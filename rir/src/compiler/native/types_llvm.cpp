@@ -196,18 +196,18 @@ int initializeTypes(LLVMContext& context) {
         llvm::FunctionType::get(t::SEXP, {t::Int}, false);
 
     NativeBuiltins::call.llvmSignature = llvm::FunctionType::get(
-        t::SEXP, {t::voidPtr, t::Int, t::SEXP, t::SEXP, t::i64, t::i64}, false);
-    NativeBuiltins::dotsCall.llvmSignature = llvm::FunctionType::get(
         t::SEXP,
-        {t::voidPtr, t::Int, t::SEXP, t::SEXP, t::i64, t::IntPtr, t::i64},
+        {t::voidPtr, t::Int, t::SEXP, t::SEXP, t::i64, t::i64, t::voidPtr},
         false);
     NativeBuiltins::namedCall.llvmSignature = llvm::FunctionType::get(
         t::SEXP,
-        {t::voidPtr, t::Int, t::SEXP, t::SEXP, t::i64, t::IntPtr, t::i64},
+        {t::voidPtr, t::Int, t::SEXP, t::SEXP, t::i64, t::IntPtr, t::i64,
+         t::voidPtr},
         false);
     NativeBuiltins::dotsCall.llvmSignature = llvm::FunctionType::get(
         t::SEXP,
-        {t::voidPtr, t::Int, t::SEXP, t::SEXP, t::i64, t::IntPtr, t::i64},
+        {t::voidPtr, t::Int, t::SEXP, t::SEXP, t::i64, t::IntPtr, t::i64,
+         t::voidPtr},
         false);
     NativeBuiltins::callBuiltin.llvmSignature = llvm::FunctionType::get(
         t::SEXP, {t::voidPtr, t::Int, t::SEXP, t::SEXP, t::i64}, false);
@@ -216,6 +216,8 @@ int initializeTypes(LLVMContext& context) {
     NativeBuiltins::notOp.llvmSignature = t::sexp_sexp;
     NativeBuiltins::binop.llvmSignature = t::sexp_sexpsexpint;
     NativeBuiltins::binopEnv.llvmSignature = t::sexp_sexp3int2;
+    NativeBuiltins::binopInPlace.llvmSignature = t::sexp_sexpsexpint;
+    NativeBuiltins::binopEnvInPlace.llvmSignature = t::sexp_sexp3int2;
 
     NativeBuiltins::isMissing.llvmSignature = t::int_sexpsexp;
     NativeBuiltins::asTest.llvmSignature = t::int_sexp;
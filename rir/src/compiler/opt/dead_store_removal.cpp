@@ -1,10 +1,11 @@
 #include "../analysis/dead_store.h"
+#include "../translations/rir_compiler.h"
 #include "pass_definitions.h"
 
 namespace rir {
 namespace pir {
 
-void DeadStoreRemoval::apply(RirCompiler&, ClosureVersion* function,
+void DeadStoreRemoval::apply(RirCompiler& cmp, ClosureVersion* function,
                              LogStream& log) const {
     bool noStores = Visitor::check(
         function->entry, [&](Instruction* i) { return !StVar::Cast(i); });
@@ -12,7 +13,10 @@ void DeadStoreRemoval::apply(RirCompiler&, ClosureVersion* function,
         return;
 
     {
-        DeadStoreAnalysis analysis(function, log);
+        auto& analysis = cmp.analyses.get<DeadStoreAnalysis>(
+            function, [&](LogStream& log, AnalysisCache::Dependencies&) {
+                return new DeadStoreAnalysis(function, log);
+            });
 
         Visitor::run(function->entry, [&](BB* bb) {
             auto ip = bb->begin();
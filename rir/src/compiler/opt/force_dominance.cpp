@@ -4,6 +4,7 @@
 #include "../pir/pir_impl.h"
 #include "../transform/bb.h"
 #include "../transform/replace.h"
+#include "../translations/rir_compiler.h"
 #include "pass_definitions.h"
 #include "utils/Map.h"
 #include "utils/Set.h"
@@ -373,7 +374,7 @@ class ForceDominanceAnalysis : public StaticAnalysis<ForcedBy> {
 namespace rir {
 namespace pir {
 
-void ForceDominance::apply(RirCompiler&, ClosureVersion* code,
+void ForceDominance::apply(RirCompiler& cmp, ClosureVersion* code,
                            LogStream& log) const {
     SmallSet<Force*> toInline;
     SmallSet<Force*> needsUpdate;
@@ -381,8 +382,12 @@ void ForceDominance::apply(RirCompiler&, ClosureVersion* code,
 
     bool isHuge = code->size() > Parameter::PROMISE_INLINER_MAX_SIZE;
     {
-        ForceDominanceAnalysis analysis(code, code, log);
-        analysis();
+        auto& analysis = cmp.analyses.get<ForceDominanceAnalysis>(
+            code, [&](LogStream& log, AnalysisCache::Dependencies&) {
+                auto analysis = new ForceDominanceAnalysis(code, code, log);
+                (*analysis)();
+                return analysis;
+            });
 
         auto result = analysis.result();
         if (result.eagerLikeFunction(code))
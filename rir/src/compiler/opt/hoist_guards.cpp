@@ -0,0 +1,121 @@
+#include "../analysis/available_checkpoints.h"
+#include "../analysis/loop_detection.h"
+#include "../pir/pir_impl.h"
+#include "../transform/bb.h"
+#include "../util/cfg.h"
+#include "pass_definitions.h"
+
+#include <algorithm>
+#include <unordered_set>
+
+namespace rir {
+namespace pir {
+
+// Guards which are skipped on some iterations might not be needed at all.
+// Checking them in front of the loop could deoptimize for nothing.
+static bool runsEveryIteration(BB* bb, const LoopDetection::Loop& loop,
+                               const DominanceGraph& dom) {
+    for (auto pred : loop.header()->predecessors())
+        if (loop.contains(pred) && pred != bb && !dom.dominates(bb, pred))
+            return false;
+    return true;
+}
+
+static bool definedOutside(Value* v, const LoopDetection::Loop& loop) {
+    auto i = Instruction::Cast(v);
+    return !i || !loop.contains(i->bb());
+}
+
+// The test of the guard can move along, if it is free to compute and only
+// depends on values from outside the loop
+static bool invariant(Value* test, const LoopDetection::Loop& loop) {
+    if (definedOutside(test, loop))
+        return true;
+    auto i = Instruction::Cast(test);
+    if (!i->effects.empty() || i->branchOrExit() || Phi::Cast(i))
+        return false;
+    bool res = true;
+    i->eachArg([&](Value* a) {
+        if (!definedOutside(a, loop))
+            res = false;
+    });
+    return res;
+}
+
+void HoistGuards::apply(RirCompiler&, ClosureVersion* function,
+                        LogStream& log) const {
+    LoopDetection loops(function);
+    DominanceGraph dom(function);
+    AvailableCheckpoints checkpoints(function, function, log);
+
+    // Outer loops first, their preheaders are even further out
+    std::vector<LoopDetection::Loop*> sorted;
+    for (auto& loop : loops)
+        sorted.push_back(&loop);
+    std::sort(sorted.begin(), sorted.end(),
+              [](LoopDetection::Loop* a, LoopDetection::Loop* b) {
+                  return a->size() > b->size();
+              });
+
+    struct Hoist {
+        BB* preheader;
+        BB* header;
+        Checkpoint* checkpoint;
+        std::vector<Assume*> guards;
+        std::vector<Instruction*> tests;
+    };
+    std::vector<Hoist> todo;
+    std::unordered_set<Assume*> seen;
+
+    for (auto loop : sorted) {
+        auto preheader = loop->preheader();
+        if (!preheader || preheader->isEmpty())
+            continue;
+
+        // Either the guards go to the end of the preheader, or right after
+        // its checkpoint
+        Checkpoint* cp = Checkpoint::Cast(preheader->last());
+        if (!cp && preheader->isJmp() && !preheader->last()->isDeoptBarrier())
+            cp = checkpoints.at(preheader->last());
+        if (!cp)
+            continue;
+
+        Hoist hoist = {preheader, loop->header(), cp, {}, {}};
+        for (auto bb : *loop) {
+            if (!runsEveryIteration(bb, *loop, dom))
+                continue;
+            for (auto i : *bb) {
+                auto assume = Assume::Cast(i);
+                if (!assume || seen.count(assume))
+                    continue;
+                auto test = assume->condition();
+                if (invariant(test, *loop)) {
+                    hoist.guards.push_back(assume);
+                    if (!definedOutside(test, *loop))
+                        hoist.tests.push_back(Instruction::Cast(test));
+                    seen.insert(assume);
+                }
+            }
+        }
+        if (!hoist.guards.empty())
+            todo.push_back(hoist);
+    }
+
+    for (auto& hoist : todo) {
+        auto target = hoist.preheader;
+        if (!target->isJmp())
+            target = BBTransform::splitEdge(function->nextBBId++, target,
+                                            hoist.header, function);
+
+        for (auto test : hoist.tests)
+            if (test->bb() != target)
+                test->bb()->moveToEnd(test->bb()->atPosition(test), target);
+        for (auto assume : hoist.guards) {
+            assume->checkpoint(hoist.checkpoint);
+            assume->bb()->moveToEnd(assume->bb()->atPosition(assume), target);
+        }
+    }
+}
+
+} // namespace pir
+} // namespace rir
@@ -149,6 +149,13 @@ class PASS(PromiseSplitter);
  */
 class PASS(HoistInstruction);
 
+/*
+ * Moves guards (Assume) with loop invariant tests in front of the loop, to the
+ * checkpoint available at the end of the preheader. Only guards which run on
+ * every iteration are moved.
+ */
+class PASS(HoistGuards);
+
 class PhaseMarker : public PirTranslator {
   public:
     explicit PhaseMarker(const std::string& name) : PirTranslator(name) {}
@@ -1,6 +1,9 @@
 #include "pass_scheduler.h"
 #include "pass_definitions.h"
 
+#include <algorithm>
+#include <cstdlib>
+
 namespace rir {
 namespace pir {
 
@@ -13,11 +16,24 @@ static std::regex getPassBlacklist() {
 
 static const std::regex PIR_PASS_BLACKLIST = getPassBlacklist();
 
+static unsigned getBudgetFactor() {
+    auto factor = getenv("PIR_PHASE_BUDGET");
+    return factor ? std::max(atoi(factor), 1) : 1;
+}
+
+// Scales the maximal number of iterations of all phases
+static const unsigned PIR_PHASE_BUDGET = getBudgetFactor();
+
 void PassScheduler::add(std::unique_ptr<const PirTranslator>&& t) {
     auto name = t->getName();
     if (std::regex_match(name.begin(), name.end(), PIR_PASS_BLACKLIST))
         return;
-    schedule_.push_back(std::move(t));
+    current->push_back(std::move(t));
+}
+
+void PassScheduler::nextPhase(unsigned budget) {
+    phases_.emplace_back(budget * PIR_PHASE_BUDGET);
+    before();
 }
 
 PassScheduler::PassScheduler() {
@@ -57,15 +73,19 @@ PassScheduler::PassScheduler() {
     auto addDefaultPostPhaseOpt = [&]() {
         add<HoistInstruction>();
         add<LoopInvariant>();
+        add<HoistGuards>();
         add<LoadElision>();
     };
 
+    nextPhase(0);
     add<PhaseMarker>("Initial");
 
+    // ==== Phase 1) Run the default passes until nothing changes
+    nextPhase(2);
     addDefaultPrePhaseOpt();
-    // ==== Phase 1) Run the default passes a couple of times
-    for (size_t i = 0; i < 2; ++i)
-        addDefaultOpt();
+    repeated();
+    addDefaultOpt();
+    after();
     addDefaultPostPhaseOpt();
 
     add<PhaseMarker>("Phase 1");
@@ -74,13 +94,13 @@ PassScheduler::PassScheduler() {
     //
     // This pass is scheduled second, since we want to first try to do this
     // statically in Phase 1
+    nextPhase(2);
     addDefaultPrePhaseOpt();
+    repeated();
     add<ElideEnvSpec>();
     addDefaultOpt();
     add<TypeSpeculation>();
-    add<ElideEnvSpec>();
-    addDefaultOpt();
-    add<TypeSpeculation>();
+    after();
     addDefaultPostPhaseOpt();
 
     add<PhaseMarker>("Phase 2: Env speculation");
@@ -92,11 +112,12 @@ PassScheduler::PassScheduler() {
     // Since for example even unused checkpoints keep variables live.
     //
     // After this phase it is no longer possible to add assumptions at any point
+    nextPhase(2);
     addDefaultPrePhaseOpt();
     add<CleanupCheckpoints>();
-    for (size_t i = 0; i < 2; ++i) {
-        addDefaultOpt();
-    }
+    repeated();
+    addDefaultOpt();
+    after();
     addDefaultPostPhaseOpt();
 
     // ==== Phase 3.1) Remove Framestates we did not use
@@ -111,12 +132,13 @@ PassScheduler::PassScheduler() {
     add<PhaseMarker>("Phase 3: Cleanup Checkpoints");
 
     // ==== Phase 4) Final round of default opts
+    nextPhase(4);
     addDefaultPrePhaseOpt();
-    for (size_t i = 0; i < 4; ++i) {
-        addDefaultOpt();
-        add<ElideEnvSpec>();
-        add<CleanupCheckpoints>();
-    }
+    repeated();
+    addDefaultOpt();
+    add<ElideEnvSpec>();
+    add<CleanupCheckpoints>();
+    after();
     addDefaultPostPhaseOpt();
 
     add<CleanupCheckpoints>();
@@ -7,22 +7,42 @@
 namespace rir {
 namespace pir {
 
+/*
+ * The optimizer runs in phases. Each phase runs its `before` passes once, then
+ * repeats its `repeated` passes until an iteration does not change anything,
+ * or at most `budget` times, and finally runs its `after` passes once.
+ */
 class PassScheduler {
   public:
     typedef std::vector<std::unique_ptr<const PirTranslator>> Schedule;
 
+    struct Phase {
+        explicit Phase(unsigned budget) : budget(budget) {}
+        unsigned budget;
+        Schedule before;
+        Schedule repeated;
+        Schedule after;
+    };
+    typedef std::vector<Phase> Phases;
+
     const static PassScheduler& instance() {
         static PassScheduler i;
         return i;
     }
 
-    Schedule::const_iterator begin() const { return schedule_.cbegin(); }
-    Schedule::const_iterator end() const { return schedule_.cend(); }
+    Phases::const_iterator begin() const { return phases_.cbegin(); }
+    Phases::const_iterator end() const { return phases_.cend(); }
 
   private:
     PassScheduler();
 
-    Schedule schedule_;
+    Phases phases_;
+    Schedule* current = nullptr;
+
+    void nextPhase(unsigned budget);
+    void before() { current = &phases_.back().before; }
+    void repeated() { current = &phases_.back().repeated; }
+    void after() { current = &phases_.back().after; }
 
     void add(std::unique_ptr<const PirTranslator>&&);
 
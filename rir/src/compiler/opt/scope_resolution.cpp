@@ -2,6 +2,7 @@
 #include "../analysis/scope.h"
 #include "../pir/pir_impl.h"
 #include "../transform/bb.h"
+#include "../translations/rir_compiler.h"
 #include "../util/phi_placement.h"
 #include "../util/safe_builtins_list.h"
 #include "../util/visitor.h"
@@ -89,13 +90,22 @@ class TheScopeResolution {
     ClosureVersion* function;
     DominanceGraph dom;
     DominanceFrontier dfront;
+    AnalysisCache& analyses;
     LogStream& log;
-    explicit TheScopeResolution(ClosureVersion* function, LogStream& log)
-        : function(function), dom(function), dfront(function, dom), log(log) {}
+    TheScopeResolution(ClosureVersion* function, AnalysisCache& analyses,
+                       LogStream& log)
+        : function(function), dom(function), dfront(function, dom),
+          analyses(analyses), log(log) {}
 
     void operator()() {
-        ScopeAnalysis analysis(function, log);
-        analysis();
+        auto& analysis = analyses.get<ScopeAnalysis>(
+            function,
+            [&](LogStream& log, AnalysisCache::Dependencies& dependencies) {
+                auto analysis = new ScopeAnalysis(function, log);
+                (*analysis)();
+                dependencies = analysis->getGlobalState().dependencies;
+                return analysis;
+            });
         auto& finalState = analysis.result();
         if (finalState.noReflection())
             function->properties.set(ClosureVersion::Property::NoReflection);
@@ -658,9 +668,9 @@ class TheScopeResolution {
 namespace rir {
 namespace pir {
 
-void ScopeResolution::apply(RirCompiler&, ClosureVersion* function,
+void ScopeResolution::apply(RirCompiler& cmp, ClosureVersion* function,
                             LogStream& log) const {
-    TheScopeResolution s(function, log);
+    TheScopeResolution s(function, cmp.analyses, log);
     s();
 
     // Scope resolution can sometimes generate dead phis, so we remove them
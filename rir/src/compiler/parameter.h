@@ -11,8 +11,14 @@ struct Parameter {
     static bool DEOPT_CHAOS;
     static bool DEOPT_CHAOS_SEED;
     static size_t MAX_INPUT_SIZE;
+    static size_t VERSION_CACHE_SIZE;
     static unsigned RIR_WARMUP;
+    static unsigned REGION_WARMUP;
+    static unsigned PROMISE_WARMUP;
     static unsigned DEOPT_ABANDON;
+    static unsigned COMPILE_BUDGET;
+    static unsigned COMPILE_INTERVAL;
+    static unsigned COMPILE_QUEUE_SIZE;
 
     static size_t PROMISE_INLINER_MAX_SIZE;
 
@@ -21,10 +27,16 @@ struct Parameter {
     static size_t INLINER_INITIAL_FUEL;
     static size_t INLINER_INLINE_UNLIKELY;
 
+    static unsigned COLD_BRANCH_RATIO;
+    static unsigned DOMINANT_TYPE_RATIO;
+
     static bool RIR_PRESERVE;
     static unsigned RIR_SERIALIZE_CHAOS;
 
     static unsigned RIR_CHECK_PIR_TYPES;
+
+    static bool JIT_DEBUG_INFO;
+    static bool PERF_MAP;
 };
 } // namespace pir
 } // namespace rir
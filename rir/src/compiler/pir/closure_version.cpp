@@ -113,6 +113,18 @@ size_t ClosureVersion::size() const {
     return s + Code::size();
 }
 
+bool ClosureVersion::mayBeJumpTarget() const {
+    if (!properties.includes(Property::NoReflection))
+        return true;
+    auto noDeopt = [](Instruction* i) { return !Deopt::Cast(i); };
+    bool res = !Visitor::check(entry, noDeopt);
+    eachPromise([&](Promise* p) {
+        if (!Visitor::check(p->entry, noDeopt))
+            res = true;
+    });
+    return res;
+}
+
 size_t ClosureVersion::nargs() const { return owner_->nargs(); }
 size_t ClosureVersion::effectiveNArgs() const {
     return owner_->nargs() - optimizationContext_.assumptions.numMissing();
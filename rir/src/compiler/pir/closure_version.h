@@ -40,6 +40,9 @@ class ClosureVersion : public Code {
 
     size_t inlinees = 0;
 
+    // Copied from the VersionCache, already optimized
+    bool fromCache = false;
+
   private:
     Closure* owner_;
     std::vector<Promise*> promises_;
@@ -65,6 +68,11 @@ class ClosureVersion : public Code {
 
     Properties properties;
 
+    // Non-local returns and deoptimization long-jump into the context of the
+    // function. Without reflection and deopt points neither can happen, so
+    // calls to this version do not need a setjmp.
+    bool mayBeJumpTarget() const;
+
     Closure* owner() const { return owner_; }
     size_t nargs() const;
     size_t effectiveNArgs() const;
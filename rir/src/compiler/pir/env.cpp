@@ -39,6 +39,10 @@ bool Env::isStaticEnv(Value* v) {
            v != Env::elided();
 }
 
+bool Env::isPreexistingEnv(Value* v) {
+    return isStaticEnv(v) || v == Env::notClosed();
+}
+
 bool Env::isPirEnv(Value* v) {
     return MkEnv::Cast(v) || LdFunctionEnv::Cast(v);
 }
@@ -54,6 +54,9 @@ class Env : public Value {
 
     static bool isPirEnv(Value* v);
     static bool isStaticEnv(Value* v);
+    // Envs which exist before the current function is entered, of which we
+    // only see part of the bindings
+    static bool isPreexistingEnv(Value* v);
     static bool isAnyEnv(Value* v);
 
     static bool isParentEnv(Value* a, Value* b);
@@ -2,6 +2,7 @@
 #include "pir_impl.h"
 
 #include "../analysis/query.h"
+#include "../parameter.h"
 #include "../util/ConvertAssumptions.h"
 #include "../util/cfg.h"
 #include "../util/safe_builtins_list.h"
@@ -514,10 +515,26 @@ void LdConst::printArgs(std::ostream& out, bool tty) const {
     out << val;
 }
 
+unsigned Parameter::COLD_BRANCH_RATIO =
+    getenv("PIR_COLD_BRANCH_RATIO") ? atoi(getenv("PIR_COLD_BRANCH_RATIO"))
+                                    : 100;
+
+BB* Branch::coldBranch() const {
+    if (!Parameter::COLD_BRANCH_RATIO)
+        return nullptr;
+    if (feedback.rarely(true, Parameter::COLD_BRANCH_RATIO))
+        return bb()->trueBranch();
+    if (feedback.rarely(false, Parameter::COLD_BRANCH_RATIO))
+        return bb()->falseBranch();
+    return nullptr;
+}
+
 void Branch::printArgs(std::ostream& out, bool tty) const {
     FixedLenInstruction::printArgs(out, tty);
     out << " -> BB" << bb()->trueBranch()->id << " (if true) | BB"
         << bb()->falseBranch()->id << " (if false)";
+    if (feedback.seen == ObservedTest::Both)
+        out << " [" << feedback.trueCount << "/" << feedback.falseCount << "]";
 }
 
 PirType Extract1_1D::inferType(const GetType& getType) const {
@@ -166,6 +166,7 @@ class Instruction : public Value {
     struct TypeFeedback {
         PirType type = PirType::optimistic();
         Value* value = nullptr;
+        ObservedTest test;
         rir::Code* srcCode = nullptr;
         Opcode* origin = nullptr;
     };
@@ -938,6 +939,14 @@ class Branch
     explicit Branch(Value* test)
         : FixedLenInstruction(PirType::voyd(), {{NativeType::test}}, {{test}}) {
     }
+
+    // How often the baseline took each branch
+    ObservedTest feedback;
+
+    // The successor which is hardly ever taken according to the feedback, or
+    // nullptr. Cold successors are laid out after the rest of the code.
+    BB* coldBranch() const;
+
     void printArgs(std::ostream& out, bool tty) const override;
     void printGraphArgs(std::ostream& out, bool tty) const override;
     void printGraphBranches(std::ostream& out, size_t bbId) const override;
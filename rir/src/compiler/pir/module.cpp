@@ -25,9 +25,11 @@ Closure* Module::getOrDeclareRirClosure(const std::string& name, SEXP closure,
                                         rir::Function* f) {
     // For Identification we use the real env, but for optimization we only use
     // the real environemtn if this is not an inner function. When it is an
-    // inner function, then the env is expected to change over time.
+    // inner function, then the env is expected to change over time. Regions run
+    // in the env of a different activation of their function each time.
     auto id = Idx(f, getEnv(CLOENV(closure)));
-    auto env = f->innerFunction ? Env::notClosed() : getEnv(CLOENV(closure));
+    auto env = f->innerFunction || f->region ? Env::notClosed()
+                                             : getEnv(CLOENV(closure));
     if (!closures.count(id))
         closures[id] = new Closure(name, closure, f, env);
     assert(closures.at(id)->rirClosure() == closure);
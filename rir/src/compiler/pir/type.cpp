@@ -125,17 +125,19 @@ void PirType::merge(const ObservedValues& other) {
         return;
     }
 
-    for (size_t i = 0; i < other.numTypes; ++i) {
-        const auto& record = other.seen[i];
-        if (record.object)
-            flags_.set(TypeFlags::maybeObject);
-        if (record.attribs)
-            flags_.set(TypeFlags::maybeAttrib);
-        if (!record.scalar)
-            flags_.set(TypeFlags::maybeNotScalar);
-
-        merge(record.sexptype);
-    }
+    for (size_t i = 0; i < other.numTypes; ++i)
+        merge(other.seen[i]);
+}
+
+void PirType::merge(const ObservedType& other) {
+    if (other.object)
+        flags_.set(TypeFlags::maybeObject);
+    if (other.attribs)
+        flags_.set(TypeFlags::maybeAttrib);
+    if (!other.scalar)
+        flags_.set(TypeFlags::maybeNotScalar);
+
+    merge(other.sexptype);
 }
 
 bool PirType::isInstance(SEXP val) const {
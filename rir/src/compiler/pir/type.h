@@ -203,6 +203,7 @@ struct PirType {
     }
 
     void merge(const ObservedValues& other);
+    void merge(const ObservedType& other);
     void merge(SEXPTYPE t);
 
     static constexpr PirType intReal() {
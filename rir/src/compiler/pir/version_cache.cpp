@@ -0,0 +1,227 @@
+#include "version_cache.h"
+#include "../parameter.h"
+#include "../transform/bb.h"
+#include "../util/visitor.h"
+#include "pir_impl.h"
+
+#include <unordered_set>
+
+namespace rir {
+namespace pir {
+
+size_t Parameter::VERSION_CACHE_SIZE =
+    getenv("PIR_VERSION_CACHE_SIZE") ? atoi(getenv("PIR_VERSION_CACHE_SIZE"))
+                                     : 500;
+
+static Closure* relocate(Closure* cls, Module* module) {
+    if (cls->hasOriginClosure())
+        return module->getOrDeclareRirClosure(cls->name(), cls->rirClosure(),
+                                              cls->rirFunction());
+    return module->getOrDeclareRirFunction(cls->name(), cls->rirFunction(),
+                                           cls->formals().original(),
+                                           cls->srcRef());
+}
+
+static void eachInstruction(ClosureVersion* version,
+                            const std::function<void(Instruction*)>& it) {
+    Visitor::run(version->entry, it);
+    version->eachPromise([&](Promise* p) { Visitor::run(p->entry, it); });
+}
+
+// A copy of a version still refers to the envs and closures of the module it
+// was copied from.
+static void relocate(ClosureVersion* version, Module* module,
+                     const std::function<void(StaticCall*)>& staticCall) {
+    eachInstruction(version, [&](Instruction* i) {
+        i->eachArg([&](InstrArg& arg) {
+            auto env = Env::Cast(arg.val());
+            if (env && Env::isStaticEnv(env) && env != Env::global())
+                arg.val() = module->getEnv(env->rho);
+        });
+        if (auto mk = MkFunCls::Cast(i)) {
+            mk->cls = relocate(mk->cls, module);
+        } else if (auto call = StaticCall::Cast(i)) {
+            call->cls(relocate(call->cls(), module));
+            call->hint = nullptr;
+            staticCall(call);
+        }
+    });
+}
+
+ClosureVersion* VersionCache::get(Closure* closure,
+                                  const OptimizationContext& ctx,
+                                  Module* target) {
+    auto entriesFor = entries.find(closure->rirFunction());
+    if (entriesFor == entries.end())
+        return nullptr;
+    auto& es = entriesFor->second;
+
+    SEXP closureEnv = closure->closureEnv() == Env::notClosed()
+                          ? nullptr
+                          : closure->closureEnv()->rho;
+    auto body = closure->rirFunction()->body();
+    ClosureVersion* found = nullptr;
+    size_t foundIdx = 0;
+    for (size_t i = 0; i < es.size();) {
+        auto& e = es[i];
+        // A collected function's address might be reused, its body can only
+        // be the same if it is still alive.
+        if (e.body != body || !valid(e)) {
+            evict(es, i);
+            continue;
+        }
+        if (e.closureEnv == closureEnv &&
+            e.version->optimizationContext().subtype(ctx) &&
+            (!found ||
+             found->optimizationContext() < e.version->optimizationContext())) {
+            found = e.version;
+            foundIdx = i;
+        }
+        i++;
+    }
+    if (!found)
+        return nullptr;
+    es[foundIdx].lastUse = ++uses;
+
+    auto version = closure->declareVersion(found->optimizationContext());
+    version->properties = found->properties;
+    version->inlinees = found->inlinees;
+    version->fromCache = true;
+    version->entry = BBTransform::clone(found->entry, version, version);
+    relocate(version, target, [&](StaticCall* call) {
+        if (!call->tryDispatch())
+            get(call->cls(),
+                OptimizationContext(call->inferAvailableAssumptions()), target);
+    });
+    return version;
+}
+
+void VersionCache::insert(ClosureVersion* version) {
+    if (!Parameter::VERSION_CACHE_SIZE || version->fromCache)
+        return;
+
+    Entry e;
+    e.module.reset(new Module);
+    auto closure = relocate(version->owner(), e.module.get());
+    auto& ctx = version->optimizationContext();
+    e.body = closure->rirFunction()->body();
+    e.closureEnv = closure->closureEnv() == Env::notClosed()
+                       ? nullptr
+                       : closure->closureEnv()->rho;
+
+    auto& es = entries[closure->rirFunction()];
+    for (size_t i = 0; i < es.size(); ++i) {
+        if (es[i].body == e.body && es[i].closureEnv == e.closureEnv &&
+            es[i].version->optimizationContext() == ctx) {
+            evict(es, i);
+            break;
+        }
+    }
+
+    auto copy = closure->declareVersion(ctx);
+    copy->properties = version->properties;
+    copy->inlinees = version->inlinees;
+    copy->entry = BBTransform::clone(version->entry, copy, copy);
+    relocate(copy, e.module.get(), [](StaticCall*) {});
+    e.version = copy;
+
+    std::unordered_set<SEXP> weak, strong;
+    std::unordered_set<rir::Code*> code;
+    auto weakCode = [&](rir::Code* c) {
+        if (c && code.insert(c).second)
+            e.deoptCounts.emplace_back(c, c->deoptCount);
+    };
+    if (e.closureEnv)
+        weak.insert(e.closureEnv);
+    weakCode(e.body);
+    copy->eachPromise([&](Promise* p) { weakCode(p->rirSrc()); });
+    eachInstruction(copy, [&](Instruction* i) {
+        weakCode(i->typeFeedback.srcCode);
+        i->eachArg([&](Value* v) {
+            if (Env::isStaticEnv(v) && v != Env::global())
+                weak.insert(Env::Cast(v)->rho);
+        });
+        if (auto fs = FrameState::Cast(i)) {
+            weakCode(fs->code);
+        } else if (auto as = Assume::Cast(i)) {
+            for (auto& o : as->feedbackOrigin)
+                weakCode(o.first);
+        } else if (auto rec = RecordDeoptReason::Cast(i)) {
+            weakCode(rec->reason.srcCode);
+        } else if (auto mk = MkFunCls::Cast(i)) {
+            strong.insert(mk->originalBody->container());
+            strong.insert(mk->cls->rirFunction()->container());
+        } else if (auto call = StaticCall::Cast(i)) {
+            if (call->cls()->hasOriginClosure())
+                strong.insert(call->cls()->rirClosure());
+            else
+                strong.insert(call->cls()->rirFunction()->container());
+        } else if (auto ld = LdFun::Cast(i)) {
+            if (ld->hint)
+                strong.insert(ld->hint);
+        }
+    });
+
+    e.refs = Rf_allocVector(VECSXP, weak.size() + code.size() + strong.size());
+    R_PreserveObject(e.refs);
+    size_t pos = 0;
+    for (auto s : weak)
+        SET_VECTOR_ELT(e.refs, pos++,
+                       R_MakeWeakRef(s, R_NilValue, R_NilValue, FALSE));
+    for (auto c : code)
+        SET_VECTOR_ELT(e.refs, pos++, R_MakeWeakRef(c->liveness(), R_NilValue,
+                                                    R_NilValue, FALSE));
+    for (auto s : strong)
+        SET_VECTOR_ELT(e.refs, pos++, s);
+    e.lastUse = ++uses;
+
+    es.push_back(std::move(e));
+    size_++;
+    while (size_ > Parameter::VERSION_CACHE_SIZE)
+        evictLeastRecentlyUsed();
+}
+
+bool VersionCache::valid(const Entry& e) const {
+    // Everything the entry refers to has to be checked for being alive first
+    for (size_t i = 0; i < (size_t)XLENGTH(e.refs); ++i) {
+        auto r = VECTOR_ELT(e.refs, i);
+        if (TYPEOF(r) == WEAKREFSXP && R_WeakRefKey(r) == R_NilValue)
+            return false;
+    }
+    for (auto& c : e.deoptCounts)
+        if (c.first->deoptCount != c.second)
+            return false;
+    return true;
+}
+
+void VersionCache::evict(std::vector<Entry>& es, size_t i) {
+    R_ReleaseObject(es[i].refs);
+    es.erase(es.begin() + i);
+    size_--;
+}
+
+void VersionCache::evictLeastRecentlyUsed() {
+    std::vector<Entry>* oldest = nullptr;
+    size_t oldestIdx = 0;
+    for (auto& es : entries) {
+        for (size_t i = 0; i < es.second.size(); ++i) {
+            if (!oldest ||
+                es.second[i].lastUse < (*oldest)[oldestIdx].lastUse) {
+                oldest = &es.second;
+                oldestIdx = i;
+            }
+        }
+    }
+    assert(oldest);
+    evict(*oldest, oldestIdx);
+}
+
+void VersionCache::clear() {
+    for (auto& es : entries)
+        while (!es.second.empty())
+            evict(es.second, es.second.size() - 1);
+    entries.clear();
+}
+
+} // namespace pir
+} // namespace rir
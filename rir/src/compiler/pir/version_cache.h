@@ -0,0 +1,81 @@
+#ifndef PIR_VERSION_CACHE_H
+#define PIR_VERSION_CACHE_H
+
+#include "R/r.h"
+#include "module.h"
+#include "optimization_context.h"
+#include "pir.h"
+
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace rir {
+namespace pir {
+
+/*
+ * Process-wide cache of optimized PIR.
+ *
+ * Every compilation starts from a fresh module, which used to mean that all
+ * callees had to be translated from RIR and optimized again, just to be
+ * inlined. The cache keeps a copy of every version after optimization, in its
+ * own module. When a closure is compiled again with compatible assumptions,
+ * the compiler gets a copy of the cached version instead, which is not
+ * optimized a second time.
+ *
+ * Entries are keyed by the baseline rir::Function, the closure env and the
+ * optimization context. They are dropped once any of the code they were
+ * compiled from deoptimizes, or is collected. The cache only holds weak
+ * references to envs and code (through Code::liveness), thus it does not keep
+ * them alive. Closures and functions the cached version calls or creates are
+ * kept alive until the entry is evicted, the least recently used entry goes
+ * first. Every entry has its own module, which is deleted with it, such that
+ * no stale env or closure is ever reused.
+ */
+class VersionCache {
+  public:
+    static VersionCache& instance() {
+        static VersionCache cache;
+        return cache;
+    }
+
+    // Declares a copy of a cached version of closure into closure, if there
+    // is one compatible with ctx. Static calls of the copy are dispatched to
+    // cached versions of their targets, if possible.
+    ClosureVersion* get(Closure* closure, const OptimizationContext& ctx,
+                        Module* module);
+
+    // Stores a copy of an optimized version
+    void insert(ClosureVersion* version);
+
+    void clear();
+    size_t size() const { return size_; }
+
+  private:
+    VersionCache() {}
+
+    struct Entry {
+        std::unique_ptr<Module> module;
+        ClosureVersion* version;
+        rir::Code* body;
+        SEXP closureEnv;
+        std::vector<std::pair<rir::Code*, unsigned>> deoptCounts;
+        // Weak references, and the closures and functions which are kept alive
+        SEXP refs;
+        size_t lastUse;
+    };
+
+    bool valid(const Entry& e) const;
+    void evict(std::vector<Entry>& entries, size_t i);
+    void evictLeastRecentlyUsed();
+
+    std::unordered_map<rir::Function*, std::vector<Entry>> entries;
+    size_t size_ = 0;
+    size_t uses = 0;
+};
+
+} // namespace pir
+} // namespace rir
+
+#endif
@@ -212,6 +212,16 @@ static bool testEagerCallArgs(ClosureVersion* f) {
     return success;
 }
 
+static bool testColdBranch(ClosureVersion* f) {
+    bool cold = false;
+    Visitor::run(f->entry, [&](Instruction* i) {
+        if (auto branch = Branch::Cast(i))
+            if (branch->coldBranch())
+                cold = true;
+    });
+    return cold;
+}
+
 PirCheck::Type PirCheck::parseType(const char* str) {
 #define V(Check)                                                               \
     if (strcmp(str, #Check) == 0)                                              \
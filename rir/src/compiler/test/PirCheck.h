@@ -27,6 +27,7 @@ namespace rir {
     V(TwoAdd)                                                                  \
     V(LazyCallArgs)                                                            \
     V(EagerCallArgs)                                                           \
+    V(ColdBranch)                                                              \
     V(LdVarVectorInFirstBB)
 
 struct PirCheck {
@@ -43,6 +43,7 @@ class Context {
 
     rir::Code* finalizeCode(size_t localsCnt, size_t cacheBindingsCount) {
         auto res = cs().finalize(localsCnt, cacheBindingsCount);
+        res->optimized = true;
         delete css.top();
         css.pop();
         return res;
@@ -181,6 +182,34 @@ class Pir2Rir {
                         next = code.emplace(
                             next, BC::ldvarCached(arg, cacheIndex), noSource);
                         changed = true;
+                    } else if (bc.is(rir::Opcode::ldloc_) &&
+                               next != code.end() &&
+                               next->first.is(rir::Opcode::stloc_)) {
+                        // Phi copies, operate on the locals directly
+                        auto source = bc.immediate.loc;
+                        auto target = next->first.immediate.loc;
+                        next = code.erase(it, plus(next, 1));
+                        if (source != target)
+                            next = code.emplace(
+                                next, BC::copyloc(target, source), noSource);
+                        changed = true;
+                    } else if (bc.is(rir::Opcode::ldloc_) &&
+                               next != code.end() &&
+                               next->first.is(rir::Opcode::ldloc_)) {
+                        auto first = bc.immediate.loc;
+                        auto second = next->first.immediate.loc;
+                        next = code.erase(it, plus(next, 1));
+                        next = code.emplace(next, BC::ldloc2(first, second),
+                                            noSource);
+                        changed = true;
+                    } else if (bc.is(rir::Opcode::stloc_) &&
+                               next != code.end() &&
+                               next->first.is(rir::Opcode::ldloc_) &&
+                               next->first.immediate.loc == bc.immediate.loc) {
+                        auto loc = bc.immediate.loc;
+                        next = code.erase(it, plus(next, 1));
+                        next = code.emplace(next, BC::stlocKeep(loc), noSource);
+                        changed = true;
                     } else if (bc.is(rir::Opcode::pop_)) {
                         unsigned n = 1;
                         auto last = next;
@@ -1212,6 +1241,7 @@ rir::Code* Pir2Rir::compileCode(Context& ctx, Code* code) {
         if (auto n = native.tryCompile(cls, code, promMap, refcount,
                                        needsLdVarForUpdate)) {
             res->nativeCode = (NativeCode)n;
+            native.attach(res, n);
         }
     }
     return res;
@@ -1379,6 +1409,18 @@ rir::Function* Pir2Rir::finalize() {
     }
 
     assert(signature.formalNargs() == cls->nargs());
+
+    // The argument forced first can be passed by value, as long as nothing can
+    // observe that it was not a promise. Later ones are not, since forcing
+    // the ones before might change what they read. The indices are formals,
+    // which only correspond to the positions in the (unnamed) calls emitting
+    // mk_arg_ if there are no dots.
+    if (cls->properties.includes(ClosureVersion::Property::NoReflection) &&
+        !cls->owner()->formals().hasDots() &&
+        !cls->properties.argumentForceOrder.empty())
+        signature.setForcesOnEntry(cls->properties.argumentForceOrder.front());
+    signature.jumpTarget = cls->mayBeJumpTarget();
+
     ctx.push(R_NilValue);
     auto body = compileCode(ctx, cls);
     log.finalPIR(cls);
@@ -1,6 +1,7 @@
 #include "rir_2_pir.h"
 #include "../../analysis/query.h"
 #include "../../analysis/verifier.h"
+#include "../../parameter.h"
 #include "../../pir/pir_impl.h"
 #include "../../transform/insert_cast.h"
 #include "../../util/ConvertAssumptions.h"
@@ -132,11 +133,23 @@ std::unordered_set<Opcode*> findMergepoints(rir::Code* srcCode) {
     return mergepoints;
 }
 
+// The branch frequencies recorded for the condition guide the block layout
+Branch* branchOn(Value* condition) {
+    auto branch = new Branch(condition);
+    if (auto i = Instruction::Cast(condition))
+        branch->feedback = i->typeFeedback.test;
+    return branch;
+}
+
 } // namespace
 
 namespace rir {
 namespace pir {
 
+unsigned Parameter::DOMINANT_TYPE_RATIO =
+    getenv("PIR_DOMINANT_TYPE_RATIO") ? atoi(getenv("PIR_DOMINANT_TYPE_RATIO"))
+                                      : 500;
+
 Checkpoint* Rir2Pir::addCheckpoint(rir::Code* srcCode, Opcode* pos,
                                    const RirStack& stack,
                                    Builder& insert) const {
@@ -264,9 +277,14 @@ bool Rir2Pir::compileBC(const BC& bc, Opcode* pos, Opcode* nextPos,
         insert(new StVarSuper(bc.immediateConst(), v, env));
         break;
 
-    case Opcode::asbool_:
-        push(insert(new AsTest(pop())));
+    case Opcode::asbool_: {
+        auto test = new AsTest(pop());
+        // if and while record their condition before it is converted
+        if (auto i = Instruction::Cast(test->arg(0).val()))
+            test->typeFeedback.test = i->typeFeedback.test;
+        push(insert(test));
         break;
+    }
 
     case Opcode::aslogical_:
         push(insert(new AsLogical(pop(), srcIdx)));
@@ -336,6 +354,8 @@ bool Rir2Pir::compileBC(const BC& bc, Opcode* pos, Opcode* nextPos,
 
     case Opcode::record_test_: {
         auto feedback = bc.immediate.testFeedback;
+        if (auto i = Instruction::Cast(at(0)))
+            i->typeFeedback.test = feedback;
         if (feedback.seen == ObservedTest::OnlyTrue ||
             feedback.seen == ObservedTest::OnlyFalse) {
             if (auto i = Instruction::Cast(at(0))) {
@@ -359,7 +379,14 @@ bool Rir2Pir::compileBC(const BC& bc, Opcode* pos, Opcode* nextPos,
             auto feedback = bc.immediate.typeFeedback;
             if (auto i = Instruction::Cast(at(0))) {
                 // TODO: deal with multiple locations
-                i->typeFeedback.type.merge(feedback);
+                // Speculate on a type which was seen almost exclusively. If
+                // that fails too often, the type is no longer dominant.
+                auto dominant =
+                    feedback.dominant(Parameter::DOMINANT_TYPE_RATIO);
+                if (dominant != -1)
+                    i->typeFeedback.type.merge(feedback.seen[dominant]);
+                else
+                    i->typeFeedback.type.merge(feedback);
                 i->typeFeedback.srcCode = srcCode;
                 i->typeFeedback.origin = pos;
                 if (auto force = Force::Cast(i)) {
@@ -396,8 +423,13 @@ bool Rir2Pir::compileBC(const BC& bc, Opcode* pos, Opcode* nextPos,
     }
 
     case Opcode::mk_eager_promise_:
-    case Opcode::mk_promise_: {
-        unsigned promi = bc.immediate.i;
+    case Opcode::mk_promise_:
+    case Opcode::mk_arg_: {
+        // The by-value shortcut of mk_arg_ is for the interpreter only, PIR
+        // has its own eager calls.
+        unsigned promi = bc.bc == Opcode::mk_arg_
+                             ? bc.immediate.mkArgArgs.promise
+                             : bc.immediate.i;
         rir::Code* promiseCode = srcCode->getPromise(promi);
         Value* val = UnboundValue::instance();
         if (bc.bc == Opcode::mk_eager_promise_)
@@ -1034,6 +1066,7 @@ bool Rir2Pir::compileBC(const BC& bc, Opcode* pos, Opcode* nextPos,
 
     // Silently ignored
     case Opcode::clear_binding_cache_:
+    case Opcode::record_backedge_:
     // TODO implement!
     case Opcode::isfun_:
         break;
@@ -1051,6 +1084,10 @@ bool Rir2Pir::compileBC(const BC& bc, Opcode* pos, Opcode* nextPos,
     // Opcodes handled elsewhere
     case Opcode::brtrue_:
     case Opcode::brfalse_:
+    case Opcode::asbool_brtrue_:
+    case Opcode::asbool_brfalse_:
+    case Opcode::lt_brtrue_:
+    case Opcode::eq_brfalse_:
     case Opcode::br_:
     case Opcode::ret_:
     case Opcode::return_:
@@ -1073,6 +1110,8 @@ bool Rir2Pir::compileBC(const BC& bc, Opcode* pos, Opcode* nextPos,
     case Opcode::ldloc_:
     case Opcode::stloc_:
     case Opcode::movloc_:
+    case Opcode::ldloc2_:
+    case Opcode::stloc_keep_:
     case Opcode::istype_:
     case Opcode::isstubenv_:
     case Opcode::check_missing_:
@@ -1093,6 +1132,9 @@ bool Rir2Pir::compileBC(const BC& bc, Opcode* pos, Opcode* nextPos,
     case Opcode::beginloop_:
     case Opcode::endloop_:
     case Opcode::ldddvar_:
+    // Functions with regions stay in the interpreter, only the regions are
+    // optimized
+    case Opcode::region_:
         log.unsupportedBC("Unsupported BC", bc);
         return false;
     }
@@ -1184,14 +1226,41 @@ Value* Rir2Pir::tryTranslate(rir::Code* srcCode, Builder& insert) const {
             }
 
             Instruction* condition = nullptr;
+            // Set if a superinstruction has effects between the condition and
+            // the branch, we then need checkpoints at both targets
+            bool needsCheckpoints = false;
 
             // Conditional jump
             switch (bc.bc) {
+            case Opcode::asbool_brtrue_:
+            case Opcode::asbool_brfalse_:
+            case Opcode::lt_brtrue_:
+            case Opcode::eq_brfalse_: {
+                // Superinstructions: first translate the fused condition
+                BC head = bc.bc == Opcode::lt_brtrue_
+                              ? BC::lt()
+                              : bc.bc == Opcode::eq_brfalse_ ? BC::eq()
+                                                             : BC::asbool();
+                if (!compileBC(head, pos, nextPos, srcCode, cur.stack, insert,
+                               callTargetFeedback)) {
+                    log.failed("Abort r2p due to unsupported bc");
+                    return nullptr;
+                }
+                auto last = insert.getCurrentBB()->isEmpty()
+                                ? nullptr
+                                : insert.getCurrentBB()->last();
+                needsCheckpoints =
+                    !inPromise() && last && last->isDeoptBarrier();
+                Value* v = cur.stack.pop();
+                condition = Instruction::Cast(v);
+                insert(branchOn(v));
+                break;
+            }
             case Opcode::brtrue_:
             case Opcode::brfalse_: {
                 Value* v = cur.stack.pop();
                 condition = Instruction::Cast(v);
-                insert(new Branch(v));
+                insert(branchOn(v));
                 break;
             }
             case Opcode::beginloop_:
@@ -1206,9 +1275,13 @@ Value* Rir2Pir::tryTranslate(rir::Code* srcCode, Builder& insert) const {
 
             switch (bc.bc) {
             case Opcode::brtrue_:
+            case Opcode::asbool_brtrue_:
+            case Opcode::lt_brtrue_:
                 insert.setBranch(branch, fall);
                 break;
             case Opcode::brfalse_:
+            case Opcode::asbool_brfalse_:
+            case Opcode::eq_brfalse_:
                 insert.setBranch(fall, branch);
                 break;
             default:
@@ -1243,6 +1316,17 @@ Value* Rir2Pir::tryTranslate(rir::Code* srcCode, Builder& insert) const {
                 }
             }
 
+            if (needsCheckpoints) {
+                // There is no pc between the fused condition and the branch,
+                // so the state after it can only be captured at the targets.
+                insert.enterBB(branch);
+                addCheckpoint(srcCode, trg, cur.stack, insert);
+                branch = insert.getCurrentBB();
+                insert.enterBB(fall);
+                addCheckpoint(srcCode, nextPos, cur.stack, insert);
+                fall = insert.getCurrentBB();
+            }
+
             pushWorklist(branch, trg);
 
             insert.enterBB(fall);
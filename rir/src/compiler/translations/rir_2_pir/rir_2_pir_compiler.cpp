@@ -1,5 +1,6 @@
 #include "rir_2_pir_compiler.h"
 #include "../../pir/pir_impl.h"
+#include "../../pir/version_cache.h"
 #include "R/RList.h"
 #include "rir_2_pir.h"
 
@@ -16,6 +17,7 @@
 #include "compiler/opt/pass_scheduler.h"
 
 #include <chrono>
+#include <map>
 
 namespace rir {
 namespace pir {
@@ -74,11 +76,12 @@ void Rir2PirCompiler::compileClosure(Closure* closure,
         }
     }
 
-    // Currently dots args are not supported in PIR. Unless if we statically
-    // matched all arguments correctly and are therefore guaranteed to receive a
-    // `...` list as DOTSXP in the correct location, we can support them.
-    // TODO: extend call instruction to do the necessary argument shuffling to
-    // support it in all cases
+    // Functions with dots args expect all arguments matched to their formals,
+    // with the `...` list as DOTSXP in the correct location. Either the caller
+    // matched them statically, or the interpreter does it at runtime (see
+    // rirCallWithMatchedArgs). Requests without matching come from calls the
+    // interpreter does not match, e.g. with a prebuilt arglist, and would
+    // fail again every time.
     if (!ctx.assumptions.includes(Assumption::StaticallyArgmatched) &&
         closure->formals().hasDots()) {
         closure->rirFunction()->unoptimizable = true;
@@ -95,6 +98,9 @@ void Rir2PirCompiler::compileClosure(Closure* closure,
     if (auto existing = closure->findCompatibleVersion(ctx))
         return success(existing);
 
+    if (auto cached = VersionCache::instance().get(closure, ctx, module))
+        return success(cached);
+
     auto version = closure->declareVersion(ctx);
     Builder builder(version, closure->closureEnv());
     auto& log = logger.begin(version);
@@ -213,11 +219,39 @@ std::unique_ptr<CompilerPerf> PERF = std::unique_ptr<CompilerPerf>(
 void Rir2PirCompiler::optimizeModule() {
     logger.flush();
     size_t passnr = 0;
-    for (const auto& translation : PassScheduler::instance()) {
+
+    // Counts changes to any version of the module. A pass is skipped on a
+    // version, if nothing changed since it last ran there. Its own changes
+    // count too, passes like the inliner might have more to do.
+    size_t changes = 0;
+    std::unordered_map<ClosureVersion*, size_t> fingerprints;
+    std::map<std::pair<std::string, ClosureVersion*>, size_t> lastRun;
+
+    auto countVersions = [&]() {
+        size_t n = 0;
+        module->eachPirClosureVersion([&](ClosureVersion*) { n++; });
+        return n;
+    };
+
+    // Returns true if the pass changed anything
+    auto run = [&](const PirTranslator* translation) {
+        size_t changesBefore = changes;
         module->eachPirClosure([&](Closure* c) {
             c->eachVersion([&](ClosureVersion* v) {
+                if (v->fromCache)
+                    return;
+                auto key = std::make_pair(translation->getName(), v);
+                if (!translation->isPhaseMarker() && lastRun.count(key) &&
+                    lastRun.at(key) == changes)
+                    return;
+
                 auto log = logger.get(v).forPass(passnr);
-                log.pirOptimizationsHeader(translation.get());
+                log.pirOptimizationsHeader(translation);
+
+                if (!fingerprints.count(v))
+                    fingerprints[v] = AnalysisCache::fingerprint(v);
+                auto versions = countVersions();
+                auto changesBeforePass = changes;
 
                 if (MEASURE_COMPILER_PERF)
                     startTime = std::chrono::high_resolution_clock::now();
@@ -230,7 +264,21 @@ void Rir2PirCompiler::optimizeModule() {
                     PERF->addTime(translation->getName(), passDuration.count());
                 }
 
-                log.pirOptimizations(translation.get());
+                if (!translation->isPhaseMarker()) {
+                    auto after = AnalysisCache::fingerprint(v);
+                    if (after != fingerprints.at(v)) {
+                        analyses.invalidate(v);
+                        changes++;
+                    }
+                    if (versions != countVersions()) {
+                        analyses.invalidateInterprocedural();
+                        changes++;
+                    }
+                    fingerprints[v] = after;
+                    lastRun[key] = changesBeforePass;
+                }
+
+                log.pirOptimizations(translation);
                 log.flush();
 
 #ifdef FULLVERIFIER
@@ -244,7 +292,23 @@ void Rir2PirCompiler::optimizeModule() {
             });
         });
         passnr++;
+        return changes != changesBefore;
+    };
+
+    for (const auto& phase : PassScheduler::instance()) {
+        for (const auto& translation : phase.before)
+            run(translation.get());
+        for (unsigned i = 0; i < phase.budget; ++i) {
+            bool changed = false;
+            for (const auto& translation : phase.repeated)
+                changed = run(translation.get()) || changed;
+            if (!changed)
+                break;
+        }
+        for (const auto& translation : phase.after)
+            run(translation.get());
     }
+
     if (MEASURE_COMPILER_PERF)
         startTime = std::chrono::high_resolution_clock::now();
 
@@ -267,6 +331,12 @@ void Rir2PirCompiler::optimizeModule() {
         PERF->addTime("Verification", passDuration.count());
     }
 
+    // Lowering to RIR destroys the optimized PIR, keep a copy for later
+    // compilations
+    module->eachPirClosureVersion(
+        [](ClosureVersion* v) { VersionCache::instance().insert(v); });
+    analyses.clear();
+
     logger.flush();
 }
 
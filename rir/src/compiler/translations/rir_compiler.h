@@ -1,6 +1,7 @@
 #ifndef RIR__PIR_COMPILER_H
 #define RIR__PIR_COMPILER_H
 
+#include "../analysis/analysis_cache.h"
 #include "../debugging/debugging.h"
 #include "../pir/closure.h"
 #include "../pir/module.h"
@@ -27,6 +28,9 @@ class RirCompiler {
 
     Module* module;
 
+    // Analyses shared between the passes of one optimizeModule
+    AnalysisCache analyses;
+
   protected:
     Preserve preserve_;
 };
@@ -88,6 +88,13 @@ Builder::Builder(ClosureVersion* version, Value* closureEnv)
     function->entry = bb;
     auto closure = version->owner();
 
+    // Regions have no arguments and run in the env of the function they were
+    // outlined from
+    if (closure->rirFunction()->region) {
+        this->env = closureEnv;
+        return;
+    }
+
     auto& assumptions = version->assumptions();
     std::vector<Value*> args(closure->nargs());
     size_t nargs = closure->nargs() - assumptions.numMissing();
@@ -276,9 +276,13 @@ class VisitorImplementation {
                         !bb->isEmpty() && ScheduledDeopt::Cast(bb->last());
                     bool returnBranch =
                         !bb->isEmpty() && Return::Cast(bb->last());
+                    bool coldBranch = false;
+                    if (!cur->isEmpty())
+                        if (auto branch = Branch::Cast(cur->last()))
+                            coldBranch = branch->coldBranch() == bb;
                     if (deoptBranch) {
                         delayed.push_back(bb);
-                    } else if (returnBranch) {
+                    } else if (returnBranch || coldBranch) {
                         delayed.push_front(bb);
                     } else {
                         enqueue(todo, bb);
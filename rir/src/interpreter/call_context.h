@@ -19,6 +19,18 @@
 
 namespace rir {
 
+// Outcome of the last dispatch at a call site of native code, if it picked
+// the newest version and that version needs no more assumptions than the
+// call site guarantees statically. A hit then skips inspecting the arguments.
+// It only holds raw pointers and keeps nothing alive: the entry is used only
+// if the dispatch table of the callee is the cached one, still has the same
+// number of versions and the cached version last.
+struct CallSiteCache {
+    SEXP table;
+    Function* fun;
+    uint32_t size;
+};
+
 struct CallContext {
     CallContext(Code* c, SEXP callee, size_t nargs, SEXP ast,
                 R_bcstack_t* stackArgs, Immediate* names, SEXP callerEnv,
@@ -59,6 +71,7 @@ struct CallContext {
     const SEXP callee;
     Assumptions givenAssumptions;
     SEXP arglist = nullptr;
+    CallSiteCache* cache = nullptr;
 
     bool hasEagerCallee() const { return TYPEOF(callee) == BUILTINSXP; }
     bool hasNames() const { return names; }
@@ -68,6 +81,12 @@ struct CallContext {
         return ostack_at_cell(stackArgs + i);
     }
 
+    // Only used to replace arguments passed by value by mk_arg_
+    void setStackArg(unsigned i, SEXP val) const {
+        assert(stackArgs && i < passedArgs);
+        ostack_at_cell(const_cast<R_bcstack_t*>(stackArgs + i)) = val;
+    }
+
     SEXP name(unsigned i, InterpreterInstance* ctx) const {
         assert(hasNames() && i < suppliedArgs);
         return cp_pool_at(ctx, names[i]);
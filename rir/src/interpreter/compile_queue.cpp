@@ -0,0 +1,149 @@
+#include "compile_queue.h"
+#include "compiler/parameter.h"
+#include "instance.h"
+#include "runtime/DispatchTable.h"
+
+#include <algorithm>
+#include <chrono>
+
+namespace rir {
+
+unsigned pir::Parameter::COMPILE_BUDGET =
+    getenv("PIR_COMPILE_BUDGET") ? atoi(getenv("PIR_COMPILE_BUDGET")) : 0;
+unsigned pir::Parameter::COMPILE_INTERVAL =
+    getenv("PIR_COMPILE_INTERVAL") ? atoi(getenv("PIR_COMPILE_INTERVAL"))
+                                   : 1000;
+unsigned pir::Parameter::COMPILE_QUEUE_SIZE =
+    getenv("PIR_COMPILE_QUEUE_SIZE") ? atoi(getenv("PIR_COMPILE_QUEUE_SIZE"))
+                                     : 16;
+
+std::vector<CompileQueue::Request> CompileQueue::pending;
+double CompileQueue::credit = pir::Parameter::COMPILE_BUDGET;
+double CompileQueue::lastRefill = 0;
+bool CompileQueue::compiling = false;
+
+// Sets compiling while it is alive. R errors longjmp out of the optimizer
+// without running destructors, thus the flag is also cleared by the cleanup
+// of an R context.
+class CompileQueue::Compiling {
+    RCNTXT cntxt;
+    static void clear(void*) { compiling = false; }
+
+  public:
+    Compiling() {
+        Rf_begincontext(&cntxt, CTXT_CCODE, R_NilValue, R_BaseEnv, R_BaseEnv,
+                        R_NilValue, R_NilValue);
+        cntxt.cend = &clear;
+        cntxt.cenddata = nullptr;
+        compiling = true;
+    }
+    ~Compiling() {
+        Rf_endcontext(&cntxt);
+        compiling = false;
+    }
+};
+
+static double now() {
+    using namespace std::chrono;
+    return duration<double, std::milli>(steady_clock::now().time_since_epoch())
+        .count();
+}
+
+void CompileQueue::refill() {
+    double t = now();
+    if (lastRefill != 0 && pir::Parameter::COMPILE_INTERVAL > 0)
+        credit += (t - lastRefill) * pir::Parameter::COMPILE_BUDGET /
+                  pir::Parameter::COMPILE_INTERVAL;
+    credit = std::min(credit, (double)pir::Parameter::COMPILE_BUDGET);
+    lastRefill = t;
+}
+
+double CompileQueue::heat(const Request& r) {
+    auto baseline = DispatchTable::unpack(BODY(r.callee))->baseline();
+    return (double)baseline->invocationCount() * baseline->body()->codeSize;
+}
+
+bool CompileQueue::wanted(const Request& r) {
+    auto table = DispatchTable::unpack(BODY(r.callee));
+    auto baseline = table->baseline();
+    return !baseline->unoptimizable &&
+           baseline->deoptCount() < pir::Parameter::DEOPT_ABANDON &&
+           !table->contains(r.given);
+}
+
+void CompileQueue::drop(std::vector<Request>::iterator r) {
+    R_ReleaseObject(r->callee);
+    pending.erase(r);
+}
+
+bool CompileQueue::request(InterpreterInstance* ctx, SEXP callee,
+                           const Assumptions& given, SEXP name) {
+    // A budget of 0 means unlimited compile time
+    if (pir::Parameter::COMPILE_BUDGET == 0) {
+        ctx->closureOptimizer(callee, given, name);
+        return true;
+    }
+
+    // Satisfied already, or given up on
+    if (!wanted({callee, given, name}))
+        return true;
+
+    auto same = [&](const Request& r) {
+        return BODY(r.callee) == BODY(callee) && r.given == given;
+    };
+
+    auto queued = std::find_if(pending.begin(), pending.end(), same);
+    if (queued == pending.end()) {
+        R_PreserveObject(callee);
+        pending.push_back({callee, given, name});
+    } else {
+        // The closure environment might have changed (e.g. for regions)
+        R_PreserveObject(callee);
+        R_ReleaseObject(queued->callee);
+        queued->callee = callee;
+        queued->name = name;
+    }
+
+    for (auto r = pending.begin(); r != pending.end();) {
+        if (wanted(*r)) {
+            r++;
+        } else {
+            auto i = r - pending.begin();
+            drop(r);
+            r = pending.begin() + i;
+        }
+    }
+    if (pending.size() > pir::Parameter::COMPILE_QUEUE_SIZE) {
+        drop(std::min_element(pending.begin(), pending.end(),
+                              [](const Request& a, const Request& b) {
+                                  return heat(a) < heat(b);
+                              }));
+    }
+
+    // Compiling might run into another request, e.g. by forcing a promise
+    if (compiling)
+        return false;
+
+    refill();
+    Compiling guard;
+    bool done = false;
+    while (credit > 0 && !pending.empty()) {
+        auto hottest = std::max_element(pending.begin(), pending.end(),
+                                        [](const Request& a, const Request& b) {
+                                            return heat(a) < heat(b);
+                                        });
+        Request next = *hottest;
+        pending.erase(hottest);
+
+        double start = now();
+        ctx->closureOptimizer(next.callee, next.given, next.name);
+        credit -= now() - start;
+        R_ReleaseObject(next.callee);
+
+        if (BODY(next.callee) == BODY(callee) && next.given == given)
+            done = true;
+    }
+    return done;
+}
+
+} // namespace rir
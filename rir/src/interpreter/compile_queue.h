@@ -0,0 +1,61 @@
+#ifndef RIR_COMPILE_QUEUE_H
+#define RIR_COMPILE_QUEUE_H
+
+#include "R/r.h"
+#include "runtime/Assumptions.h"
+
+#include <vector>
+
+namespace rir {
+
+struct InterpreterInstance;
+struct DispatchTable;
+
+/*
+ * Requests to optimize a closure, issued by the interpreter once a function
+ * (or region) gets warm, go through the compile queue.
+ *
+ * By default every request is compiled right away. With PIR_COMPILE_BUDGET
+ * set, the optimizer gets a budget of PIR_COMPILE_BUDGET ms compile time per
+ * PIR_COMPILE_INTERVAL ms wall-clock time, which is replenished continuously.
+ * While there is budget left, the pending requests are compiled hottest
+ * first. Otherwise they stay queued and the interpreter keeps running the
+ * current version. Requests which are already satisfied, or whose function
+ * gave up on optimization in the meantime, are dropped, and so is the coldest
+ * request once more than PIR_COMPILE_QUEUE_SIZE are pending.
+ *
+ * The heat of a request is the number of invocations (for regions also the
+ * back-edges) of the baseline times its size, i.e. an estimate of its share
+ * of the runtime. It changes while the request waits, thus it is computed
+ * when picking the next request instead of being kept in a heap.
+ */
+class CompileQueue {
+  public:
+    // Queues the request to optimize callee for the given assumptions and
+    // compiles the hottest pending requests the budget allows. Returns false
+    // if this request was deferred or dropped.
+    static bool request(InterpreterInstance* ctx, SEXP callee,
+                        const Assumptions& given, SEXP name);
+
+  private:
+    struct Request {
+        SEXP callee;
+        Assumptions given;
+        SEXP name;
+    };
+
+    static std::vector<Request> pending;
+    static double credit;
+    static double lastRefill;
+    static bool compiling;
+    class Compiling;
+
+    static void refill();
+    static double heat(const Request&);
+    static bool wanted(const Request&);
+    static void drop(std::vector<Request>::iterator);
+};
+
+} // namespace rir
+
+#endif
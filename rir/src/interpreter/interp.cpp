@@ -5,12 +5,16 @@
 #include "R/RList.h"
 #include "R/Symbols.h"
 #include "cache.h"
+#include "compile_queue.h"
 #include "compiler/parameter.h"
 #include "compiler/translations/rir_2_pir/rir_2_pir_compiler.h"
 #include "event_counters.h"
+#include "ir/Compiler.h"
 #include "ir/Deoptimization.h"
+#include "opcode_profile.h"
 #include "runtime/TypeFeedback_inl.h"
 #include "safe_force.h"
+#include "sampling_profile.h"
 #include "utils/Pool.h"
 
 #include <assert.h>
@@ -75,9 +79,57 @@ static RIR_INLINE SEXP getSrcForCall(Code* c, Opcode* pc,
     return src_pool_at(ctx, sidx);
 }
 
+// Converts the condition of an if/while to a C bool, pc is the instruction
+// that needs the condition (used for the error and warning call)
+static RIR_INLINE bool asBool(SEXP val, Code* c, Opcode* pc,
+                              InterpreterInstance* ctx) {
+    int cond = NA_LOGICAL;
+    if (XLENGTH(val) > 1)
+        Rf_warningcall(getSrcAt(c, pc, ctx),
+                       "the condition has length > 1 and only the first "
+                       "element will be used");
+
+    if (XLENGTH(val) > 0) {
+        switch (TYPEOF(val)) {
+        case LGLSXP:
+            cond = LOGICAL(val)[0];
+            break;
+        case INTSXP:
+            cond = INTEGER(val)[0]; // relies on NA_INTEGER == NA_LOGICAL
+            break;
+        default:
+            cond = Rf_asLogical(val);
+        }
+    }
+
+    if (cond == NA_LOGICAL) {
+        const char* msg =
+            XLENGTH(val)
+                ? (isLogical(val) ? ("missing value where TRUE/FALSE needed")
+                                  : ("argument is not interpretable as logical"))
+                : ("argument is of length zero");
+        Rf_errorcall(getSrcAt(c, pc, ctx), msg);
+    }
+    return cond;
+}
+
 #define PC_BOUNDSCHECK(pc, c)                                                  \
     SLOWASSERT((pc) >= (c)->code() && (pc) < (c)->endCode());
 
+// Build with -DPROFILE_OPCODES to be able to collect an OpcodeProfile
+#ifdef PROFILE_OPCODES
+#define PROFILE_DISPATCH()                                                     \
+    do {                                                                       \
+        if (OpcodeProfile::running)                                            \
+            OpcodeProfile::instance().dispatch(c, lastOpcode, *pc);            \
+        lastOpcode = *pc;                                                      \
+    } while (false)
+#else
+#define PROFILE_DISPATCH()                                                     \
+    do {                                                                       \
+    } while (false)
+#endif
+
 #ifdef THREADED_CODE
 #define BEGIN_MACHINE NEXT();
 #define INSTRUCTION(name)                                                      \
@@ -86,19 +138,24 @@ static RIR_INLINE SEXP getSrcForCall(Code* c, Opcode* pc,
 #define NEXT()                                                                 \
     (__extension__({                                                           \
         printInterp(pc, c, ctx);                                               \
+        PROFILE_DISPATCH();                                                    \
         goto* opAddr[static_cast<uint8_t>(advanceOpcode())];                   \
     }))
 #define LASTOP                                                                 \
     { printLastop(); }
 #else
 #define NEXT()                                                                 \
-    (__extension__({ goto* opAddr[static_cast<uint8_t>(advanceOpcode())]; }))
+    (__extension__({                                                           \
+        PROFILE_DISPATCH();                                                    \
+        goto* opAddr[static_cast<uint8_t>(advanceOpcode())];                   \
+    }))
 #define LASTOP                                                                 \
     {}
 #endif
 #else
 #define BEGIN_MACHINE                                                          \
     loop:                                                                      \
+    PROFILE_DISPATCH();                                                        \
     switch (advanceOpcode())
 #define INSTRUCTION(name)                                                      \
     case Opcode::name:                                                         \
@@ -148,6 +205,8 @@ void initClosureContext(SEXP ast, RCNTXT* cntxt, SEXP rho, SEXP sysparent,
                         R_GlobalContext->sysparent, arglist, op);
     else
         Rf_begincontext(cntxt, CTXT_RETURN, ast, rho, sysparent, arglist, op);
+    // No version recorded yet, see SamplingProfile::setVersion
+    cntxt->cenddata = nullptr;
 }
 
 static void endClosureContext(RCNTXT* cntxt, SEXP result) {
@@ -353,6 +412,7 @@ static RIR_INLINE SEXP rirCallTrampoline(const CallContext& call, Function* fun,
 
     initClosureContext(call.ast, &cntxt, env, call.callerEnv, arglist,
                        call.callee);
+    SamplingProfile::setVersion(&cntxt, fun);
     R_Srcref = getAttrib(call.callee, symbol::srcref);
 
     closureDebug(call.ast, call.callee, env, R_NilValue, &cntxt);
@@ -362,8 +422,11 @@ static RIR_INLINE SEXP rirCallTrampoline(const CallContext& call, Function* fun,
 
     Code* code = fun->body();
     // Pass &cntxt.cloenv, to let evalRirCode update the env of the current
-    // context
-    SEXP result = rirCallTrampoline_(cntxt, call, code, env, ctx);
+    // context. The context stays visible to stack walks either way, only the
+    // setjmp is skipped if nothing can jump back into it.
+    SEXP result = fun->signature().jumpTarget
+                      ? rirCallTrampoline_(cntxt, call, code, env, ctx)
+                      : evalRirCode(code, ctx, env, &call);
     PROTECT(result);
 
     endClosureDebug(call.ast, call.callee, env);
@@ -387,8 +450,10 @@ static RIR_INLINE SEXP rirCallTrampoline(const CallContext& call, Function* fun,
 static unsigned int count = 0;
 
 // Interrupt Signal Checker - Allows for Ctrl - C functionality to exit out
-// of infinite loops
-void checkUserInterrupt() {
+// of infinite loops. Also the safe point of the sampling profiler, c and pc
+// locate the current instruction if known.
+void checkUserInterrupt(Code* c = nullptr, Opcode* pc = nullptr) {
+    SamplingProfile::safepoint(c, pc);
     if (++count > UI_COUNT_DELTA) {
         R_CheckUserInterrupt();
         R_RunPendingFinalizers();
@@ -409,6 +474,9 @@ void recordDeoptReason(SEXP val, const DeoptReason& reason) {
         assert(*pos == Opcode::record_type_);
         ObservedValues* feedback = (ObservedValues*)(pos + 1);
         feedback->record(val);
+        // Do not speculate on the most common type only again, or rare
+        // values could keep deoptimizing
+        feedback->unstable = 1;
         if (TYPEOF(val) == PROMSXP) {
             if (PRVALUE(val) == R_UnboundValue &&
                 feedback->stateBeforeLastForce < ObservedValues::promise)
@@ -765,14 +833,268 @@ static Function* dispatch(const CallContext& call, DispatchTable* vt) {
         }
     }
     assert(fun);
-
     return fun;
 };
 
+static Function* cachedDispatch(const CallContext& call, DispatchTable* vt) {
+    auto cache = call.cache;
+    if (cache && cache->table == vt->container() && cache->size == vt->size() &&
+        vt->get(vt->size() - 1) == cache->fun)
+        return cache->fun;
+    return nullptr;
+}
+
+// Only the newest version is cached, for any other one a more specific
+// version might match the next call. It has to match with what the call site
+// guarantees statically, i.e. without looking at the arguments.
+static void updateCallSiteCache(const CallContext& call, DispatchTable* vt,
+                                Function* fun, Assumptions given) {
+    auto cache = call.cache;
+    if (!cache)
+        return;
+    auto& signature = fun->signature();
+    if (fun == vt->get(vt->size() - 1) &&
+        signature.optimization !=
+            FunctionSignature::OptimizationLevel::Baseline) {
+        if (!call.hasNames())
+            given.add(Assumption::CorrectOrderOfArguments);
+        if (call.suppliedArgs <= signature.formalNargs()) {
+            given.numMissing(signature.formalNargs() - call.suppliedArgs);
+            given.add(Assumption::NotTooManyArguments);
+        }
+        if (signature.assumptions.subtype(given)) {
+            *cache = {vt->container(), fun, (uint32_t)vt->size()};
+            return;
+        }
+    }
+    cache->table = nullptr;
+}
+
+// mk_arg_ passes values for arguments that the newest version of the callee
+// forces on entry. If dispatch picked a version which does not, it gets the
+// evaluated promise it would have gotten otherwise. It is not forced yet as
+// far as missing() is concerned, thus it keeps the caller env.
+static void boxEagerArgs(const CallContext& call, const Function* fun) {
+    if (call.hasNames() || call.arglist)
+        return;
+    SEXP a = CDR(call.ast);
+    for (size_t i = 0;
+         i < call.suppliedArgs && i < FunctionSignature::MAX_TRACKED_ARGS &&
+         a != R_NilValue;
+         ++i, a = CDR(a)) {
+        SEXP arg = call.stackArg(i);
+        if (TYPEOF(arg) == PROMSXP || arg == R_MissingArg ||
+            TYPEOF(CAR(a)) != SYMSXP || fun->signature().forcesOnEntry(i))
+            continue;
+        SEXP prom = Rf_mkPROMISE(CAR(a), call.callerEnv);
+        SET_PRVALUE(prom, arg);
+        call.setStackArg(i, prom);
+    }
+}
+
+static size_t byValueCount = 0;
+size_t argsPassedByValue() { return byValueCount; }
+
+// Value of a variable in the local frame, if it can be read without side
+// effects (no active binding, no unevaluated promise) and is not a missing
+// argument filled in by its default, R_UnboundValue otherwise
+static RIR_INLINE SEXP localValue(SEXP sym, SEXP env) {
+    if (TYPEOF(sym) != SYMSXP || TYPEOF(env) != ENVSXP || env == R_BaseEnv ||
+        env == R_BaseNamespace)
+        return R_UnboundValue;
+    R_varloc_t loc = R_findVarLocInFrame(env, sym);
+    if (R_VARLOC_IS_NULL(loc) || IS_ACTIVE_BINDING(loc.cell) ||
+        MISSING(loc.cell))
+        return R_UnboundValue;
+    SEXP val = CAR(loc.cell);
+    if (TYPEOF(val) == PROMSXP)
+        val = PRVALUE(val);
+    if (val == R_MissingArg)
+        return R_UnboundValue;
+    return val;
+}
+
 unsigned pir::Parameter::RIR_WARMUP =
     getenv("PIR_WARMUP") ? atoi(getenv("PIR_WARMUP")) : 3;
 unsigned pir::Parameter::DEOPT_ABANDON =
     getenv("PIR_DEOPT_ABANDON") ? atoi(getenv("PIR_DEOPT_ABANDON")) : 10;
+unsigned pir::Parameter::REGION_WARMUP =
+    getenv("PIR_REGION_WARMUP") ? atoi(getenv("PIR_REGION_WARMUP")) : 1000;
+unsigned pir::Parameter::PROMISE_WARMUP =
+    getenv("PIR_PROMISE_WARMUP") ? atoi(getenv("PIR_PROMISE_WARMUP")) : 0;
+
+// Back-edges (and entries) of a region before it gets optimized
+static unsigned regionWarmup(Code* body) {
+    return pir::Parameter::REGION_WARMUP * (body->deoptCount + 1);
+}
+
+static bool isHotRegion(Function* fun) {
+    return !fun->unoptimizable && !isDeoptimizing() &&
+           fun->deoptCount() < pir::Parameter::DEOPT_ABANDON &&
+           fun->invocationCount() >= regionWarmup(fun->body());
+}
+
+// Returned by record_backedge_ to restart the region in optimized code
+const static SEXP regionOsrMarker = (SEXP)0x7008;
+
+// Regions are called through a closure with the dispatch table as body and
+// the current env as closure env, which optimized code expects to find there.
+static bool isRegionCall(const CallContext* call) {
+    if (!call || TYPEOF(call->callee) != CLOSXP)
+        return false;
+    auto table = DispatchTable::check(BODY(call->callee));
+    return table && table->baseline()->region;
+}
+
+static SEXP mkRegionClosure(DispatchTable* table, SEXP env) {
+    SEXP callee = Rf_allocSExp(CLOSXP);
+    SET_FORMALS(callee, R_NilValue);
+    SET_BODY(callee, table->container());
+    SET_CLOENV(callee, env);
+    return callee;
+}
+
+// A region which is entered often (i.e. a promise) can pass a closure to
+// reuse, its env is set for the duration of the run.
+static SEXP runRegion(Code* c, DispatchTable* table, SEXP env,
+                      InterpreterInstance* ctx, SEXP cached = nullptr) {
+    Function* baseline = table->baseline();
+    baseline->registerInvocation();
+
+    for (;;) {
+        SEXP res;
+        if (table->size() == 1 && !isHotRegion(baseline)) {
+            res = evalRirCode(baseline->body(), ctx, env, nullptr);
+        } else {
+            SEXP callee = cached ? cached : mkRegionClosure(table, env);
+            PROTECT(callee);
+            // Optimized code only reads the env on entry, but a nested run
+            // of the same region must not leave its env behind
+            SEXP outerEnv = CLOENV(callee);
+            SET_CLOENV(callee, env);
+
+            Assumptions given = pir::Rir2PirCompiler::defaultAssumptions;
+            given.add(Assumption::NoExplicitlyMissingArgs);
+            given.add(Assumption::StaticallyArgmatched);
+            CallContext call(c, callee, 0,
+                             src_pool_at(ctx, baseline->body()->src), nullptr,
+                             env, given, ctx);
+            Function* fun = dispatch(call, table);
+            if (fun == baseline && isHotRegion(baseline)) {
+                if (CompileQueue::request(ctx, callee, given, R_NilValue)) {
+                    fun = dispatch(call, table);
+                    if (fun == baseline)
+                        baseline->unoptimizable = true;
+                }
+            }
+
+            if (fun == baseline) {
+                res = evalRirCode(baseline->body(), ctx, env, nullptr);
+            } else {
+                // The version could be replaced while we are running it
+                PROTECT(fun->container());
+                fun->registerInvocation();
+                // Deoptimization continues the region in the baseline version
+                // and then breaks out of this context with its result
+                RCNTXT cntxt;
+                Rf_begincontext(&cntxt, CTXT_LOOP, R_NilValue, env, R_BaseEnv,
+                                R_NilValue, R_NilValue);
+                if (int s = SETJMP(cntxt.cjmpbuf)) {
+                    if (s != CTXT_BREAK)
+                        Rf_error("no loop for break/next, jumping to top "
+                                 "level");
+                    res = R_ReturnedValue;
+                } else {
+                    res = evalRirCode(fun->body(), ctx, env, &call);
+                }
+                Rf_endcontext(&cntxt);
+                UNPROTECT(1);
+            }
+            SET_CLOENV(callee, outerEnv);
+            UNPROTECT(1);
+        }
+
+        if (res != regionOsrMarker)
+            return res;
+    }
+}
+
+static bool hasDotsFormals(SEXP formals) {
+    for (SEXP f = formals; f != R_NilValue; f = CDR(f))
+        if (TAG(f) == R_DotsSymbol)
+            return true;
+    return false;
+}
+
+// True if the baseline version got enough invocations to be compiled again
+static bool compileDue(Function* fun) {
+    return !isDeoptimizing() &&
+           fun->deoptCount() < pir::Parameter::DEOPT_ABANDON &&
+           fun->invocationCount() %
+                   (fun->deoptCount() + pir::Parameter::RIR_WARMUP) ==
+               0;
+}
+
+// PIR compiles functions with `...` formals only for statically argmatched
+// calls, which pass the arguments in the order of the formals and the dots
+// packed into a DOTSXP. For all other calls rirCall does the matching here,
+// but only if an optimized version exists or the baseline is due to be
+// compiled. Returns nullptr if we end up with the baseline version, which is
+// then called as usual with the arglist built here, left in call.arglist.
+static SEXP rirCallWithMatchedArgs(CallContext& call, DispatchTable* table,
+                                   InterpreterInstance* ctx) {
+    SEXP arglist = createLegacyLazyArgsList(call, ctx);
+    PROTECT(arglist);
+    SEXP actuals = Rf_matchArgs(FORMALS(call.callee), arglist, call.ast);
+    PROTECT(actuals);
+
+    size_t n = 0;
+    for (SEXP a = actuals; a != R_NilValue; a = CDR(a), ++n)
+        ostack_push(ctx, CAR(a));
+    assert(n > 0);
+
+    Assumptions given;
+    given.add(Assumption::StaticallyArgmatched);
+    CallContext matched(const_cast<Code*>(call.caller), call.callee, n,
+                        call.ast, ostack_cell_at(ctx, n - 1), nullptr,
+                        call.callerEnv, given, ctx);
+    // The callee still sees the arguments in the order they were supplied
+    matched.arglist = arglist;
+    addDynamicAssumptionsFromContext(matched);
+    Function* fun = dispatch(matched, table);
+
+    if (fun == table->baseline() && compileDue(fun)) {
+        Assumptions given =
+            addDynamicAssumptionsForOneTarget(matched, fun->signature());
+        if (given.includes(pir::Rir2PirCompiler::minimalAssumptions)) {
+            SEXP lhs = CAR(call.ast);
+            if (CompileQueue::request(ctx, call.callee, given,
+                                      TYPEOF(lhs) == SYMSXP ? lhs
+                                                            : R_NilValue)) {
+                fun = dispatch(matched, table);
+                if (fun == table->baseline())
+                    fun->unoptimizable = true;
+            }
+        }
+    }
+
+    SEXP result = nullptr;
+    if (fun != table->baseline()) {
+        assert(fun->signature().envCreation ==
+               FunctionSignature::Environment::CalleeCreated);
+        fun->registerInvocation();
+        matched.givenAssumptions =
+            addDynamicAssumptionsForOneTarget(matched, fun->signature());
+        supplyMissingArgs(matched, fun);
+        result = rirCallTrampoline(matched, fun, arglist, ctx);
+    }
+
+    ostack_popn(ctx, matched.passedArgs);
+    UNPROTECT(2);
+    if (!result)
+        call.arglist = arglist;
+    return result;
+}
 
 static unsigned serializeCounter = 0;
 
@@ -793,16 +1115,44 @@ RIR_INLINE SEXP rirCall(CallContext& call, InterpreterInstance* ctx) {
 
     auto table = DispatchTable::unpack(body);
 
-    addDynamicAssumptionsFromContext(call);
-    Function* fun = dispatch(call, table);
+    // A hit in the call site cache does not need to inspect the arguments
+    Function* fun = cachedDispatch(call, table);
+    bool argumentsInspected = !fun;
+    if (!fun) {
+        auto staticallyGiven = call.givenAssumptions;
+        addDynamicAssumptionsFromContext(call);
+        fun = dispatch(call, table);
+        updateCallSiteCache(call, table, fun, staticallyGiven);
+    }
     fun->registerInvocation();
 
-    if (!isDeoptimizing() && !fun->unoptimizable &&
+    bool arglistPreserved = false;
+    if (fun == table->baseline() && !fun->unoptimizable && !call.arglist &&
+        !call.givenAssumptions.includes(Assumption::StaticallyArgmatched) &&
+        (table->size() > 1 || compileDue(fun)) &&
+        hasDotsFormals(FORMALS(call.callee))) {
+        // The matched arglist is built from the supplied arguments, which
+        // need to be promises
+        boxEagerArgs(call, fun);
+        if (auto result = rirCallWithMatchedArgs(call, table, ctx)) {
+            if (bodyPreserved)
+                UNPROTECT(1);
+            return result;
+        }
+        PROTECT(call.arglist);
+        arglistPreserved = true;
+    }
+
+    // Dots functions need matched arguments, rirCallWithMatchedArgs already
+    // requested the compile for this call
+    if (!isDeoptimizing() && !fun->unoptimizable && !arglistPreserved &&
         fun->deoptCount() < pir::Parameter::DEOPT_ABANDON &&
         ((fun != table->baseline() && fun->invocationCount() >= 2 &&
           fun->invocationCount() <= pir::Parameter::RIR_WARMUP) ||
          (fun->invocationCount() %
           (fun->deoptCount() + pir::Parameter::RIR_WARMUP)) == 0)) {
+        if (!argumentsInspected)
+            addDynamicAssumptionsFromContext(call);
         Assumptions given =
             addDynamicAssumptionsForOneTarget(call, fun->signature());
         // addDynamicAssumptionForOneTarget compares arguments with the
@@ -826,11 +1176,13 @@ RIR_INLINE SEXP rirCall(CallContext& call, InterpreterInstance* ctx) {
                 SEXP name = R_NilValue;
                 if (TYPEOF(lhs) == SYMSXP)
                     name = lhs;
-                ctx->closureOptimizer(call.callee, given, name);
-                fun = dispatch(call, table);
+                if (CompileQueue::request(ctx, call.callee, given, name))
+                    fun = dispatch(call, table);
             }
         }
     }
+    boxEagerArgs(call, fun);
+
     Assumptions derived =
         addDynamicAssumptionsForOneTarget(call, fun->signature());
     call.givenAssumptions = derived;
@@ -915,6 +1267,8 @@ RIR_INLINE SEXP rirCall(CallContext& call, InterpreterInstance* ctx) {
             result = rirCallTrampoline(call, fun, arglist, ctx);
     }
 
+    if (arglistPreserved)
+        UNPROTECT(1);
     if (bodyPreserved)
         UNPROTECT(1);
 
@@ -1537,6 +1891,10 @@ void deoptFramesWithContext(InterpreterInstance* ctx,
     auto originalCntxt = findFunctionContextFor(deoptEnv);
     if (originalCntxt) {
         cntxt = originalCntxt;
+        // From now on the frame continues in the baseline
+        if (TYPEOF(cntxt->callfun) == CLOSXP)
+            if (auto table = DispatchTable::check(BODY(cntxt->callfun)))
+                SamplingProfile::setVersion(cntxt, table->baseline());
     } else {
         // NOTE: this assert triggers if we can't find the context of the
         // current function. Usually the reason is that a wrong environment is
@@ -1620,6 +1978,10 @@ void deoptFramesWithContext(InterpreterInstance* ctx,
     } else {
         endDeoptimizing();
         assert(findFunctionContextFor(deoptEnv) == cntxt);
+        // Regions have no function context, their result goes back to
+        // runRegion instead
+        if (isRegionCall(callCtxt))
+            Rf_findcontext(CTXT_BREAK, cntxt->cloenv, res);
         // long-jump out of all the inlined contexts
         Rf_findcontext(CTXT_BROWSER | CTXT_FUNCTION, cntxt->cloenv, res);
         assert(false);
@@ -1754,6 +2116,9 @@ SEXP evalRirCode(Code* c, InterpreterInstance* ctx, SEXP env,
     ostack_ensureSize(ctx, c->stackLength + 5);
 
     Opcode* pc;
+#ifdef PROFILE_OPCODES
+    Opcode lastOpcode = Opcode::invalid_;
+#endif
 
     if (initialPC) {
         pc = initialPC;
@@ -2458,6 +2823,23 @@ SEXP evalRirCode(Code* c, InterpreterInstance* ctx, SEXP env,
             NEXT();
         }
 
+        INSTRUCTION(ldloc2_) {
+            Immediate first = readImmediate();
+            advanceImmediate();
+            Immediate second = readImmediate();
+            advanceImmediate();
+            ostack_push(ctx, locals.load(first));
+            ostack_push(ctx, locals.load(second));
+            NEXT();
+        }
+
+        INSTRUCTION(stloc_keep_) {
+            Immediate offset = readImmediate();
+            advanceImmediate();
+            locals.store(offset, ostack_top(ctx));
+            NEXT();
+        }
+
         INSTRUCTION(record_call_) {
             ObservedCallees* feedback = (ObservedCallees*)pc;
             SEXP callee = ostack_top(ctx);
@@ -2727,6 +3109,30 @@ SEXP evalRirCode(Code* c, InterpreterInstance* ctx, SEXP env,
             NEXT();
         }
 
+        INSTRUCTION(mk_arg_) {
+            Immediate id = readImmediate();
+            advanceImmediate();
+            Immediate position = readImmediate();
+            advanceImmediate();
+            Code* promCode = c->getPromise(id);
+            SEXP callee = ostack_at(ctx, position);
+            SEXP val = R_UnboundValue;
+            if (TYPEOF(callee) == CLOSXP && DispatchTable::check(BODY(callee)) &&
+                DispatchTable::unpack(BODY(callee))
+                    ->best()
+                    ->signature()
+                    .forcesOnEntry(position))
+                val = localValue(src_pool_at(ctx, promCode->src), env);
+            if (val != R_UnboundValue) {
+                ENSURE_NAMEDMAX(val);
+                ostack_push(ctx, val);
+                byValueCount++;
+            } else {
+                ostack_push(ctx, Rf_mkPROMISE(promCode->container(), env));
+            }
+            NEXT();
+        }
+
         INSTRUCTION(update_promise_) {
             auto val = ostack_pop(ctx);
             auto prom = ostack_pop(ctx);
@@ -3174,38 +3580,7 @@ SEXP evalRirCode(Code* c, InterpreterInstance* ctx, SEXP env,
         }
 
         INSTRUCTION(asbool_) {
-            SEXP val = ostack_top(ctx);
-            int cond = NA_LOGICAL;
-            if (XLENGTH(val) > 1)
-                Rf_warningcall(
-                    getSrcAt(c, pc - 1, ctx),
-                    "the condition has length > 1 and only the first "
-                    "element will be used");
-
-            if (XLENGTH(val) > 0) {
-                switch (TYPEOF(val)) {
-                case LGLSXP:
-                    cond = LOGICAL(val)[0];
-                    break;
-                case INTSXP:
-                    cond =
-                        INTEGER(val)[0]; // relies on NA_INTEGER == NA_LOGICAL
-                    break;
-                default:
-                    cond = Rf_asLogical(val);
-                }
-            }
-
-            if (cond == NA_LOGICAL) {
-                const char* msg =
-                    XLENGTH(val)
-                        ? (isLogical(val)
-                               ? ("missing value where TRUE/FALSE needed")
-                               : ("argument is not interpretable as logical"))
-                        : ("argument is of length zero");
-                Rf_errorcall(getSrcAt(c, pc - 1, ctx), msg);
-            }
-
+            bool cond = asBool(ostack_top(ctx), c, pc - 1, ctx);
             ostack_pop(ctx);
             ostack_push(ctx, cond ? R_TrueValue : R_FalseValue);
             NEXT();
@@ -3392,7 +3767,7 @@ SEXP evalRirCode(Code* c, InterpreterInstance* ctx, SEXP env,
             JumpOffset offset = readJumpOffset();
             advanceJump();
             if (ostack_pop(ctx) == R_TrueValue) {
-                checkUserInterrupt();
+                checkUserInterrupt(c, pc);
                 pc += offset;
             }
             PC_BOUNDSCHECK(pc, c);
@@ -3403,7 +3778,7 @@ SEXP evalRirCode(Code* c, InterpreterInstance* ctx, SEXP env,
             JumpOffset offset = readJumpOffset();
             advanceJump();
             if (ostack_pop(ctx) == R_FalseValue) {
-                checkUserInterrupt();
+                checkUserInterrupt(c, pc);
                 pc += offset;
             }
             PC_BOUNDSCHECK(pc, c);
@@ -3413,12 +3788,70 @@ SEXP evalRirCode(Code* c, InterpreterInstance* ctx, SEXP env,
         INSTRUCTION(br_) {
             JumpOffset offset = readJumpOffset();
             advanceJump();
-            checkUserInterrupt();
+            checkUserInterrupt(c, pc);
             pc += offset;
             PC_BOUNDSCHECK(pc, c);
             NEXT();
         }
 
+        INSTRUCTION(asbool_brtrue_) {
+            bool cond = asBool(ostack_top(ctx), c, pc - 1, ctx);
+            ostack_pop(ctx);
+            JumpOffset offset = readJumpOffset();
+            advanceJump();
+            if (cond) {
+                checkUserInterrupt(c, pc);
+                pc += offset;
+            }
+            PC_BOUNDSCHECK(pc, c);
+            NEXT();
+        }
+
+        INSTRUCTION(asbool_brfalse_) {
+            bool cond = asBool(ostack_top(ctx), c, pc - 1, ctx);
+            ostack_pop(ctx);
+            JumpOffset offset = readJumpOffset();
+            advanceJump();
+            if (!cond) {
+                checkUserInterrupt(c, pc);
+                pc += offset;
+            }
+            PC_BOUNDSCHECK(pc, c);
+            NEXT();
+        }
+
+        // The relop fallback needs the source of the instruction at pc - 1,
+        // therefore the jump offset is only read after the comparison.
+        INSTRUCTION(lt_brtrue_) {
+            SEXP lhs = ostack_at(ctx, 1);
+            SEXP rhs = ostack_at(ctx, 0);
+            DO_RELOP(<);
+            ostack_popn(ctx, 2);
+            JumpOffset offset = readJumpOffset();
+            advanceJump();
+            if (res == R_TrueValue) {
+                checkUserInterrupt(c, pc);
+                pc += offset;
+            }
+            PC_BOUNDSCHECK(pc, c);
+            NEXT();
+        }
+
+        INSTRUCTION(eq_brfalse_) {
+            SEXP lhs = ostack_at(ctx, 1);
+            SEXP rhs = ostack_at(ctx, 0);
+            DO_RELOP(==);
+            ostack_popn(ctx, 2);
+            JumpOffset offset = readJumpOffset();
+            advanceJump();
+            if (res == R_FalseValue) {
+                checkUserInterrupt(c, pc);
+                pc += offset;
+            }
+            PC_BOUNDSCHECK(pc, c);
+            NEXT();
+        }
+
         INSTRUCTION(extract1_1_) {
             SEXP val = ostack_at(ctx, 1);
             SEXP idx = ostack_at(ctx, 0);
@@ -4145,7 +4578,7 @@ SEXP evalRirCode(Code* c, InterpreterInstance* ctx, SEXP env,
             advanceJump();
             loopTrampoline(c, ctx, env, callCtxt, pc, localsBase, bindingCache);
             pc += offset;
-            checkUserInterrupt();
+            checkUserInterrupt(c, pc);
             assert(*pc == Opcode::endloop_);
             advanceOpcode();
             NEXT();
@@ -4153,6 +4586,26 @@ SEXP evalRirCode(Code* c, InterpreterInstance* ctx, SEXP env,
 
         INSTRUCTION(endloop_) { return loopTrampolineMarker; }
 
+        INSTRUCTION(region_) {
+            auto table = DispatchTable::unpack(readConst(ctx, readImmediate()));
+            advanceImmediate();
+            res = runRegion(c, table, env, ctx);
+            ostack_push(ctx, res);
+            NEXT();
+        }
+
+        INSTRUCTION(record_backedge_) {
+            bool restartable = readImmediate();
+            advanceImmediate();
+            // c is the body of the baseline version of a region, the only
+            // code which counts back-edges
+            c->registerInvocation();
+            if (restartable && !isDeoptimizing() &&
+                c->funInvocationCount == regionWarmup(c))
+                return regionOsrMarker;
+            NEXT();
+        }
+
         INSTRUCTION(return_) {
             res = ostack_pop(ctx);
             // this restores stack pointer to the value from the target context
@@ -4266,6 +4719,33 @@ SEXP rirEval_f(SEXP what, SEXP env) {
     // TODO: do we not need an RCNTXT here?
 
     if (auto code = Code::check(what)) {
+        // Promises (and default args) of baseline code which are forced
+        // often get compiled on their own as a region running in the promise
+        // env. They are counted separately from invocations, which are the
+        // denominator of the call feedback of inlined promises. Constants and
+        // variables are not worth the detour through runRegion.
+        if (!code->optimized && Compiler::regions &&
+            pir::Parameter::PROMISE_WARMUP) {
+            if (code->region() == R_NilValue) {
+                if (code->forceCount < UINT_MAX)
+                    code->forceCount++;
+                if (code->forceCount == pir::Parameter::PROMISE_WARMUP) {
+                    SEXP ast = src_pool_at(globalContext(), code->src);
+                    if (TYPEOF(ast) == LANGSXP) {
+                        if (SEXP table = Compiler::compileRegion(ast)) {
+                            PROTECT(table);
+                            code->region(mkRegionClosure(
+                                DispatchTable::unpack(table), R_EmptyEnv));
+                            UNPROTECT(1);
+                        }
+                    }
+                }
+            }
+            if (code->region() != R_NilValue)
+                return runRegion(
+                    code, DispatchTable::unpack(BODY(code->region())), env,
+                    globalContext(), code->region());
+        }
         return evalRirCodeExtCaller(code, globalContext(), env);
     }
 
@@ -30,6 +30,9 @@ SEXP evalRirCodeExtCaller(Code* c, InterpreterInstance* ctx, SEXP env);
 SEXP evalRirCode(Code* c, InterpreterInstance* ctx, SEXP env,
                  const CallContext* callContext);
 
+// Number of arguments mk_arg_ passed by value so far, for tests
+size_t argsPassedByValue();
+
 SEXP rirEval_f(SEXP f, SEXP env);
 SEXP rirApplyClosure(SEXP, SEXP, SEXP, SEXP, SEXP);
 
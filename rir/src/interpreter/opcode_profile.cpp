@@ -0,0 +1,169 @@
+#include "opcode_profile.h"
+#include "R/Printing.h"
+#include "R/Protect.h"
+#include "instance.h"
+#include "interp_incl.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+namespace rir {
+
+// The instance is created lazily on the first dispatch, which then picks up
+// the sampling interval from the environment
+bool OpcodeProfile::running = getenv("RIR_OPCODE_PROFILE") != nullptr;
+
+OpcodeProfile::OpcodeProfile() {
+    reset();
+    if (auto interval = getenv("RIR_OPCODE_PROFILE")) {
+        dumpOnExit = true;
+        start(std::max(atoi(interval), 1));
+    }
+}
+
+OpcodeProfile::~OpcodeProfile() {
+    if (!dumpOnExit)
+        return;
+    std::ofstream file;
+    file.open("rir_opcode_profile.csv");
+    file << "first, second, count, samples, cycles\n";
+    for (size_t i = 0; i < NumOpcodes; ++i) {
+        if (!counts[i])
+            continue;
+        file << BC::name(static_cast<Opcode>(i)) << ", , " << counts[i] << ", "
+             << samples[i] << ", " << cycles[i] << "\n";
+    }
+    for (size_t i = 0; i < NumOpcodes; ++i) {
+        for (size_t j = 0; j < NumOpcodes; ++j) {
+            auto n = pairs[i * NumOpcodes + j];
+            if (!n)
+                continue;
+            file << BC::name(static_cast<Opcode>(i)) << ", "
+                 << BC::name(static_cast<Opcode>(j)) << ", " << n << ", , \n";
+        }
+    }
+    file.close();
+}
+
+void OpcodeProfile::start(unsigned interval) {
+    samplingInterval = countdown = interval;
+    running = true;
+}
+
+void OpcodeProfile::stop() {
+    running = false;
+    pendingSample = false;
+}
+
+void OpcodeProfile::reset() {
+    counts.fill(0);
+    samples.fill(0);
+    cycles.fill(0);
+    pairs.fill(0);
+    perCode.clear();
+    lastCode = nullptr;
+    lastEntry = nullptr;
+    pendingSample = false;
+    countdown = samplingInterval;
+}
+
+SEXP OpcodeProfile::report() const {
+    Protect p;
+
+    auto names = [&](std::initializer_list<const char*> ns) {
+        SEXP res = p(Rf_allocVector(STRSXP, ns.size()));
+        size_t i = 0;
+        for (auto n : ns)
+            SET_STRING_ELT(res, i++, Rf_mkChar(n));
+        return res;
+    };
+
+    // Opcodes, in declaration order
+    std::vector<size_t> ops;
+    for (size_t i = 0; i < NumOpcodes; ++i)
+        if (counts[i])
+            ops.push_back(i);
+    SEXP opName = p(Rf_allocVector(STRSXP, ops.size()));
+    SEXP opCount = p(Rf_allocVector(REALSXP, ops.size()));
+    SEXP opSamples = p(Rf_allocVector(REALSXP, ops.size()));
+    SEXP opCycles = p(Rf_allocVector(REALSXP, ops.size()));
+    for (size_t i = 0; i < ops.size(); ++i) {
+        SET_STRING_ELT(opName, i,
+                       Rf_mkChar(BC::name(static_cast<Opcode>(ops[i]))));
+        REAL(opCount)[i] = counts[ops[i]];
+        REAL(opSamples)[i] = samples[ops[i]];
+        REAL(opCycles)[i] = cycles[ops[i]];
+    }
+    SEXP opcodes = p(Rf_allocVector(VECSXP, 4));
+    SET_VECTOR_ELT(opcodes, 0, opName);
+    SET_VECTOR_ELT(opcodes, 1, opCount);
+    SET_VECTOR_ELT(opcodes, 2, opSamples);
+    SET_VECTOR_ELT(opcodes, 3, opCycles);
+    Rf_setAttrib(opcodes, R_NamesSymbol,
+                 names({"name", "count", "samples", "cycles"}));
+
+    // Pairs, most frequent first
+    std::vector<size_t> prs;
+    for (size_t i = 0; i < pairs.size(); ++i)
+        if (pairs[i])
+            prs.push_back(i);
+    std::sort(prs.begin(), prs.end(),
+              [&](size_t a, size_t b) { return pairs[a] > pairs[b]; });
+    SEXP first = p(Rf_allocVector(STRSXP, prs.size()));
+    SEXP second = p(Rf_allocVector(STRSXP, prs.size()));
+    SEXP pairCount = p(Rf_allocVector(REALSXP, prs.size()));
+    for (size_t i = 0; i < prs.size(); ++i) {
+        SET_STRING_ELT(
+            first, i,
+            Rf_mkChar(BC::name(static_cast<Opcode>(prs[i] / NumOpcodes))));
+        SET_STRING_ELT(
+            second, i,
+            Rf_mkChar(BC::name(static_cast<Opcode>(prs[i] % NumOpcodes))));
+        REAL(pairCount)[i] = pairs[prs[i]];
+    }
+    SEXP pairList = p(Rf_allocVector(VECSXP, 3));
+    SET_VECTOR_ELT(pairList, 0, first);
+    SET_VECTOR_ELT(pairList, 1, second);
+    SET_VECTOR_ELT(pairList, 2, pairCount);
+    Rf_setAttrib(pairList, R_NamesSymbol, names({"first", "second", "count"}));
+
+    // Code objects, hottest first
+    typedef std::pair<Code*, CodeEntry> Entry;
+    std::vector<Entry> codes(perCode.begin(), perCode.end());
+    std::sort(codes.begin(), codes.end(), [](const Entry& a, const Entry& b) {
+        return a.second.executed > b.second.executed;
+    });
+    SEXP codeAddr = p(Rf_allocVector(STRSXP, codes.size()));
+    SEXP codeSrc = p(Rf_allocVector(STRSXP, codes.size()));
+    SEXP codeExecuted = p(Rf_allocVector(REALSXP, codes.size()));
+    for (size_t i = 0; i < codes.size(); ++i) {
+        std::stringstream addr;
+        addr << (void*)codes[i].first;
+        SET_STRING_ELT(codeAddr, i, Rf_mkChar(addr.str().c_str()));
+        // The source pool is never cleared, so this is safe even if the code
+        // object is long gone
+        SET_STRING_ELT(
+            codeSrc, i,
+            Rf_mkChar(
+                dumpSexp(src_pool_at(globalContext(), codes[i].second.src))
+                    .c_str()));
+        REAL(codeExecuted)[i] = codes[i].second.executed;
+    }
+    SEXP codeList = p(Rf_allocVector(VECSXP, 3));
+    SET_VECTOR_ELT(codeList, 0, codeAddr);
+    SET_VECTOR_ELT(codeList, 1, codeSrc);
+    SET_VECTOR_ELT(codeList, 2, codeExecuted);
+    Rf_setAttrib(codeList, R_NamesSymbol, names({"code", "src", "executed"}));
+
+    SEXP res = p(Rf_allocVector(VECSXP, 3));
+    SET_VECTOR_ELT(res, 0, opcodes);
+    SET_VECTOR_ELT(res, 1, pairList);
+    SET_VECTOR_ELT(res, 2, codeList);
+    Rf_setAttrib(res, R_NamesSymbol, names({"opcodes", "pairs", "code"}));
+    return res;
+}
+
+} // namespace rir
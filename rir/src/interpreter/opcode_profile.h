@@ -0,0 +1,127 @@
+#ifndef RIR_OPCODE_PROFILE_H
+#define RIR_OPCODE_PROFILE_H
+
+#include "R/r.h"
+#include "ir/BC_inc.h"
+#include "runtime/Code.h"
+
+#include <array>
+#include <cstdint>
+#include <unordered_map>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <chrono>
+#endif
+
+namespace rir {
+
+/*
+ * Execution profile of the bytecode interpreter.
+ *
+ * The hook in evalRirCode is only compiled in with -DPROFILE_OPCODES (the
+ * ReleaseProfile build type) and does nothing until the profile is started,
+ * either with RIR_OPCODE_PROFILE=<n> or from R with rir.opcodeProfile.start.
+ * While running, every dispatched instruction is counted per opcode, per pair
+ * of consecutively executed opcodes (within one evalRirCode activation) and
+ * per Code object. Every n-th instruction is additionally timed with rdtsc
+ * until the next dispatch anywhere. For a call of rir code that is the first
+ * instruction of the callee, thus only the overhead of the call is counted.
+ * Builtins and GNU R code called by the instruction are included though, and
+ * so is, for the last instruction of a code object, whatever runs before the
+ * interpreter dispatches again. Cycles are therefore only meaningful as
+ * averages over many samples.
+ */
+class OpcodeProfile {
+  public:
+    static constexpr size_t NumOpcodes = static_cast<size_t>(Opcode::num_of);
+
+    struct CodeEntry {
+        unsigned src = 0;
+        size_t executed = 0;
+    };
+
+    static OpcodeProfile& instance() {
+        static OpcodeProfile p;
+        return p;
+    }
+
+    // Checked on every dispatch, therefore a plain global
+    static bool running;
+
+    static RIR_INLINE uint64_t timestamp() {
+#if defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#else
+        return std::chrono::steady_clock::now().time_since_epoch().count();
+#endif
+    }
+
+    // Called right before op is dispatched, prev is the last opcode executed
+    // in the same activation of evalRirCode (or invalid_ on entry).
+    RIR_INLINE void dispatch(Code* c, Opcode prev, Opcode op) {
+        if (pendingSample) {
+            cycles[static_cast<size_t>(sampledOp)] += timestamp() - sampleStart;
+            samples[static_cast<size_t>(sampledOp)]++;
+            pendingSample = false;
+        }
+
+        counts[static_cast<size_t>(op)]++;
+        if (prev != Opcode::invalid_)
+            pairs[static_cast<size_t>(prev) * NumOpcodes +
+                  static_cast<size_t>(op)]++;
+
+        if (c != lastCode) {
+            lastEntry = &perCode[c];
+            lastEntry->src = c->src;
+            lastCode = c;
+        }
+        lastEntry->executed++;
+
+        if (--countdown == 0) {
+            countdown = samplingInterval;
+            pendingSample = true;
+            sampledOp = op;
+            sampleStart = timestamp();
+        }
+    }
+
+    void start(unsigned interval);
+    void stop();
+    void reset();
+
+    // Returns list(opcodes = list(name, count, samples, cycles),
+    //              pairs = list(first, second, count),
+    //              code = list(code, src, executed))
+    SEXP report() const;
+
+  private:
+    OpcodeProfile();
+    ~OpcodeProfile();
+
+    std::array<size_t, NumOpcodes> counts;
+    std::array<size_t, NumOpcodes> samples;
+    std::array<uint64_t, NumOpcodes> cycles;
+    std::array<size_t, NumOpcodes * NumOpcodes> pairs;
+
+    // Code objects are not tracked by the GC, a dead code object might share
+    // its entry with a later one allocated at the same address.
+    std::unordered_map<Code*, CodeEntry> perCode;
+    Code* lastCode = nullptr;
+    CodeEntry* lastEntry = nullptr;
+
+    unsigned samplingInterval = 100;
+    unsigned countdown = 100;
+    bool pendingSample = false;
+    Opcode sampledOp = Opcode::invalid_;
+    uint64_t sampleStart = 0;
+
+    // Set if the profile was started by RIR_OPCODE_PROFILE, in which case it
+    // is dumped to rir_opcode_profile.csv on exit.
+    bool dumpOnExit = false;
+};
+
+} // namespace rir
+
+#endif
@@ -0,0 +1,201 @@
+#include "sampling_profile.h"
+#include "R/Printing.h"
+#include "R/Protect.h"
+#include "R/Symbols.h"
+#include "instance.h"
+#include "interp_incl.h"
+#include "runtime/DispatchTable.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <sys/time.h>
+#include <vector>
+
+namespace rir {
+
+volatile sig_atomic_t SamplingProfile::pending = 0;
+
+static struct sigaction previousHandler;
+
+static void onTick(int) {
+    SamplingProfile::pending = SamplingProfile::pending + 1;
+}
+
+// Unlike the opcode profile nothing polls the instance before the timer is
+// armed, thus it has to be created eagerly when started from the environment
+static struct StartFromEnv {
+    StartFromEnv() {
+        if (getenv("RIR_PROFILE"))
+            SamplingProfile::instance();
+    }
+} startFromEnv;
+
+SamplingProfile::SamplingProfile() {
+    if (auto interval = getenv("RIR_PROFILE")) {
+        dumpOnExit = true;
+        start(std::max(atoi(interval), 1));
+    }
+}
+
+SamplingProfile::~SamplingProfile() {
+    stop();
+    if (!dumpOnExit)
+        return;
+    std::ofstream file;
+    file.open("rir_profile.folded");
+    for (auto& s : stacks)
+        file << s.first << " " << s.second << "\n";
+    file.close();
+}
+
+void SamplingProfile::start(unsigned intervalMs) {
+    if (running)
+        stop();
+
+    struct sigaction action;
+    action.sa_handler = onTick;
+    sigemptyset(&action.sa_mask);
+    action.sa_flags = SA_RESTART;
+    sigaction(SIGPROF, &action, &previousHandler);
+
+    struct itimerval timer;
+    timer.it_interval.tv_sec = intervalMs / 1000;
+    timer.it_interval.tv_usec = (intervalMs % 1000) * 1000;
+    timer.it_value = timer.it_interval;
+    setitimer(ITIMER_PROF, &timer, nullptr);
+    running = true;
+}
+
+void SamplingProfile::stop() {
+    if (!running)
+        return;
+    struct itimerval timer = {};
+    setitimer(ITIMER_PROF, &timer, nullptr);
+    sigaction(SIGPROF, &previousHandler, nullptr);
+    running = false;
+    pending = 0;
+}
+
+void SamplingProfile::reset() {
+    stacks.clear();
+    pending = 0;
+}
+
+// Contexts not created by rir (e.g. by S3 dispatch in GNU R) might carry
+// garbage in cenddata, thus the version is only trusted if it is (still) in
+// the dispatch table of the callee.
+static Function* recordedVersion(DispatchTable* table, RCNTXT* cptr) {
+    for (size_t i = 0; i < table->size(); ++i)
+        if (table->get(i) == cptr->cenddata)
+            return table->get(i);
+    return nullptr;
+}
+
+static std::string frameName(RCNTXT* cptr) {
+    std::stringstream out;
+    SEXP call = cptr->call;
+    if (TYPEOF(call) == LANGSXP && TYPEOF(CAR(call)) == SYMSXP)
+        out << CHAR(PRINTNAME(CAR(call)));
+    else
+        out << "<anonymous>";
+
+    SEXP fun = cptr->callfun;
+    DispatchTable* table =
+        TYPEOF(fun) == CLOSXP ? DispatchTable::check(BODY(fun)) : nullptr;
+    if (!table) {
+        out << " [gnur]";
+    } else if (!cptr->cenddata) {
+        out << " [inlined]";
+    } else if (auto version = recordedVersion(table, cptr)) {
+        auto& sig = version->signature();
+        if (sig.optimization == FunctionSignature::OptimizationLevel::Baseline)
+            out << " [baseline]";
+        else
+            out << " [" << (version->body()->nativeCode ? "native" : "rir")
+                << " " << sig.assumptions << "]";
+    } else {
+        out << " [unknown]";
+    }
+
+    // Where the function was defined, if the source was kept
+    SEXP srcref = Rf_getAttrib(fun, symbol::srcref);
+    if (TYPEOF(srcref) == INTSXP && XLENGTH(srcref) > 0) {
+        out << " ";
+        SEXP srcfile = Rf_getAttrib(srcref, R_SrcfileSymbol);
+        if (TYPEOF(srcfile) == ENVSXP) {
+            SEXP name = Rf_findVarInFrame(srcfile, Rf_install("filename"));
+            if (TYPEOF(name) == STRSXP && XLENGTH(name) > 0)
+                out << CHAR(STRING_ELT(name, 0));
+        }
+        out << ":" << INTEGER(srcref)[0];
+    }
+    return out.str();
+}
+
+void SamplingProfile::sample(Code* c, Opcode* pc) {
+    size_t ticks = pending;
+    pending = 0;
+    if (!running || sampling)
+        return;
+    sampling = true;
+
+    // Innermost first
+    std::vector<std::string> frames;
+    SEXP location = R_NilValue;
+    if (c && pc) {
+        if (auto src = c->getSrcIdxBefore(pc))
+            location = src_pool_at(globalContext(), src);
+    }
+    for (RCNTXT* cptr = R_GlobalContext; cptr; cptr = cptr->nextcontext) {
+        if (!(cptr->callflag & CTXT_FUNCTION))
+            continue;
+        auto frame = frameName(cptr);
+        if (location != R_NilValue)
+            frame += " @ " + dumpSexp(location, 40);
+        std::replace(frame.begin(), frame.end(), ';', ',');
+        frames.push_back(frame);
+        location = cptr->call;
+    }
+
+    std::string stack;
+    for (auto f = frames.rbegin(); f != frames.rend(); ++f) {
+        if (!stack.empty())
+            stack += ";";
+        stack += *f;
+    }
+    if (stack.empty())
+        stack = "<toplevel>";
+    stacks[stack] += ticks;
+
+    sampling = false;
+}
+
+SEXP SamplingProfile::report() const {
+    Protect p;
+
+    typedef std::pair<std::string, size_t> Entry;
+    std::vector<Entry> sorted(stacks.begin(), stacks.end());
+    std::sort(sorted.begin(), sorted.end(), [](const Entry& a, const Entry& b) {
+        return a.second > b.second;
+    });
+
+    SEXP stack = p(Rf_allocVector(STRSXP, sorted.size()));
+    SEXP samples = p(Rf_allocVector(REALSXP, sorted.size()));
+    for (size_t i = 0; i < sorted.size(); ++i) {
+        SET_STRING_ELT(stack, i, Rf_mkChar(sorted[i].first.c_str()));
+        REAL(samples)[i] = sorted[i].second;
+    }
+
+    SEXP res = p(Rf_allocVector(VECSXP, 2));
+    SET_VECTOR_ELT(res, 0, stack);
+    SET_VECTOR_ELT(res, 1, samples);
+    SEXP names = p(Rf_allocVector(STRSXP, 2));
+    SET_STRING_ELT(names, 0, Rf_mkChar("stack"));
+    SET_STRING_ELT(names, 1, Rf_mkChar("samples"));
+    Rf_setAttrib(res, R_NamesSymbol, names);
+    return res;
+}
+
+} // namespace rir
@@ -0,0 +1,83 @@
+#ifndef RIR_SAMPLING_PROFILE_H
+#define RIR_SAMPLING_PROFILE_H
+
+#include "R/r.h"
+#include "ir/BC_inc.h"
+
+#include <csignal>
+#include <string>
+#include <unordered_map>
+
+namespace rir {
+
+struct Code;
+struct Function;
+
+/*
+ * Sampling profiler attributing run time to R functions, the version of
+ * each function which is running, and source locations.
+ *
+ * Started with RIR_PROFILE=<ms> or from R with rir.profile.start, it arms
+ * ITIMER_PROF. The SIGPROF handler only counts the tick, the sample is taken
+ * at the next safe point: on entry to evalRirCode, on back-edges of the
+ * interpreter and when native code calls another native version through the
+ * trampoline. Ticks arriving while native code loops without calling out
+ * are therefore attributed to the next safe point. Since R's own Rprof uses
+ * the same timer, the two cannot run at the same time.
+ *
+ * A sample walks the RCNTXT chain. The version running in a closure context
+ * is stored in the (otherwise unused) cenddata of the context, by
+ * rirCallTrampoline, the native call trampoline and deoptimization. Both
+ * variants of initClosureContext clear it, thus contexts of closures inlined
+ * into optimized code have none. Every frame is located by the call which
+ * created the next inner context; the innermost one by the source of the
+ * last instruction at or before the sampled pc. Samples are aggregated per
+ * stack in the folded format of flamegraph.pl, i.e.
+ * "f [version] @ location;g [version]" with the outermost frame first.
+ */
+class SamplingProfile {
+  public:
+    static SamplingProfile& instance() {
+        static SamplingProfile p;
+        return p;
+    }
+
+    // Ticks since the last sample, counted by the signal handler
+    static volatile sig_atomic_t pending;
+
+    // Called at safe points, c and pc locate the innermost frame if known
+    static RIR_INLINE void safepoint(Code* c = nullptr, Opcode* pc = nullptr) {
+        if (pending)
+            instance().sample(c, pc);
+    }
+
+    // Records the version executed in the closure context cntxt
+    static RIR_INLINE void setVersion(RCNTXT* cntxt, Function* fun) {
+        cntxt->cenddata = fun;
+    }
+
+    void start(unsigned intervalMs);
+    void stop();
+    void reset();
+
+    // Returns list(stack, samples), sorted by samples
+    SEXP report() const;
+
+  private:
+    SamplingProfile();
+    ~SamplingProfile();
+
+    void sample(Code* c, Opcode* pc);
+
+    bool running = false;
+    bool sampling = false;
+    std::unordered_map<std::string, size_t> stacks;
+
+    // Set if the profile was started by RIR_PROFILE, in which case it is
+    // dumped to rir_profile.folded on exit.
+    bool dumpOnExit = false;
+};
+
+} // namespace rir
+
+#endif
@@ -55,6 +55,7 @@ void BC::write(CodeStream& cs) const {
     case Opcode::starg_:
     case Opcode::stvar_super_:
     case Opcode::missing_:
+    case Opcode::region_:
         cs.insert(immediate.pool);
         return;
 
@@ -99,6 +100,10 @@ void BC::write(CodeStream& cs) const {
         cs.insert(immediate.fun);
         return;
 
+    case Opcode::mk_arg_:
+        cs.insert(immediate.mkArgArgs);
+        return;
+
     case Opcode::mk_stub_env_:
     case Opcode::mk_env_:
         cs.insert(immediate.mkEnvFixedArgs);
@@ -121,6 +126,10 @@ void BC::write(CodeStream& cs) const {
     case Opcode::beginloop_:
     case Opcode::push_context_:
     case Opcode::brfalse_:
+    case Opcode::asbool_brtrue_:
+    case Opcode::asbool_brfalse_:
+    case Opcode::lt_brtrue_:
+    case Opcode::eq_brfalse_:
         cs.patchpoint(immediate.offset);
         return;
 
@@ -134,6 +143,7 @@ void BC::write(CodeStream& cs) const {
     case Opcode::stvar_stubbed_:
     case Opcode::starg_stubbed_:
     case Opcode::ldvar_noforce_stubbed_:
+    case Opcode::record_backedge_:
         cs.insert(immediate.i);
         return;
 
@@ -143,6 +153,7 @@ void BC::write(CodeStream& cs) const {
 
     case Opcode::ldloc_:
     case Opcode::stloc_:
+    case Opcode::stloc_keep_:
         cs.insert(immediate.loc);
         return;
 
@@ -150,6 +161,10 @@ void BC::write(CodeStream& cs) const {
         cs.insert(immediate.loc_cpy);
         return;
 
+    case Opcode::ldloc2_:
+        cs.insert(immediate.loc_pair);
+        return;
+
     case Opcode::assert_type_:
         cs.insert(immediate.assertTypeArgs);
         return;
@@ -195,6 +210,7 @@ void BC::deserialize(SEXP refTable, R_inpstream_t inp, Opcode* code,
         case Opcode::stvar_:
         case Opcode::stvar_super_:
         case Opcode::missing_:
+        case Opcode::region_:
             i.pool = Pool::insert(ReadItem(refTable, inp));
             break;
         case Opcode::ldvar_cached_:
@@ -276,6 +292,7 @@ void BC::deserialize(SEXP refTable, R_inpstream_t inp, Opcode* code,
         case Opcode::record_test_:
         case Opcode::mk_promise_:
         case Opcode::mk_eager_promise_:
+        case Opcode::mk_arg_:
         case Opcode::push_code_:
         case Opcode::br_:
         case Opcode::brtrue_:
@@ -283,6 +300,10 @@ void BC::deserialize(SEXP refTable, R_inpstream_t inp, Opcode* code,
         case Opcode::push_context_:
         case Opcode::pop_context_:
         case Opcode::brfalse_:
+        case Opcode::asbool_brtrue_:
+        case Opcode::asbool_brfalse_:
+        case Opcode::lt_brtrue_:
+        case Opcode::eq_brfalse_:
         case Opcode::popn_:
         case Opcode::pick_:
         case Opcode::pull_:
@@ -296,10 +317,13 @@ void BC::deserialize(SEXP refTable, R_inpstream_t inp, Opcode* code,
         case Opcode::ldloc_:
         case Opcode::stloc_:
         case Opcode::movloc_:
+        case Opcode::ldloc2_:
+        case Opcode::stloc_keep_:
         case Opcode::ldvar_noforce_stubbed_:
         case Opcode::stvar_stubbed_:
         case Opcode::starg_stubbed_:
         case Opcode::clear_binding_cache_:
+        case Opcode::record_backedge_:
             assert((size - 1) % 4 == 0);
             InBytes(inp, code + 1, size - 1);
             break;
@@ -346,6 +370,7 @@ void BC::serialize(SEXP refTable, R_outpstream_t out, const Opcode* code,
         case Opcode::stvar_:
         case Opcode::stvar_super_:
         case Opcode::missing_:
+        case Opcode::region_:
             WriteItem(Pool::get(i.pool), refTable, out);
             break;
         case Opcode::ldvar_cached_:
@@ -419,6 +444,7 @@ void BC::serialize(SEXP refTable, R_outpstream_t out, const Opcode* code,
         case Opcode::record_test_:
         case Opcode::mk_promise_:
         case Opcode::mk_eager_promise_:
+        case Opcode::mk_arg_:
         case Opcode::push_code_:
         case Opcode::br_:
         case Opcode::brtrue_:
@@ -426,6 +452,10 @@ void BC::serialize(SEXP refTable, R_outpstream_t out, const Opcode* code,
         case Opcode::push_context_:
         case Opcode::pop_context_:
         case Opcode::brfalse_:
+        case Opcode::asbool_brtrue_:
+        case Opcode::asbool_brfalse_:
+        case Opcode::lt_brtrue_:
+        case Opcode::eq_brfalse_:
         case Opcode::popn_:
         case Opcode::pick_:
         case Opcode::pull_:
@@ -439,10 +469,13 @@ void BC::serialize(SEXP refTable, R_outpstream_t out, const Opcode* code,
         case Opcode::ldloc_:
         case Opcode::stloc_:
         case Opcode::movloc_:
+        case Opcode::ldloc2_:
+        case Opcode::stloc_keep_:
         case Opcode::ldvar_noforce_stubbed_:
         case Opcode::stvar_stubbed_:
         case Opcode::starg_stubbed_:
         case Opcode::clear_binding_cache_:
+        case Opcode::record_backedge_:
             assert((size - 1) % 4 == 0);
             if (size != 0)
                 OutBytes(out, code + 1, size - 1);
@@ -503,7 +536,8 @@ void BC::print(std::ostream& out) const {
             for (size_t i = 0; i < prof.numTypes; ++i) {
                 auto t = prof.seen[i];
                 out << Rf_type2char(t.sexptype) << "(" << (t.object ? "o" : "")
-                    << (t.attribs ? "a" : "") << (t.scalar ? "s" : "") << ")";
+                    << (t.attribs ? "a" : "") << (t.scalar ? "s" : "") << ")"
+                    << "x" << prof.hits(i);
                 if (i != (unsigned)prof.numTypes - 1)
                     out << ", ";
             }
@@ -588,6 +622,7 @@ void BC::print(std::ostream& out) const {
         break;
     }
     case Opcode::push_:
+    case Opcode::region_:
         out << dumpSexp(immediateConst()).c_str();
         break;
     case Opcode::ldfun_:
@@ -632,17 +667,26 @@ void BC::print(std::ostream& out) const {
     case Opcode::ldvar_noforce_stubbed_:
         out << immediate.i;
         break;
+    case Opcode::record_backedge_:
+        if (immediate.i)
+            out << "restartable";
+        break;
     case Opcode::ldarg_:
         out << immediate.arg_idx;
         break;
     case Opcode::ldloc_:
     case Opcode::stloc_:
+    case Opcode::stloc_keep_:
         out << "@" << immediate.loc;
         break;
     case Opcode::movloc_:
         out << "@" << immediate.loc_cpy.source << " -> @"
             << immediate.loc_cpy.target;
         break;
+    case Opcode::ldloc2_:
+        out << "@" << immediate.loc_pair.first << " @"
+            << immediate.loc_pair.second;
+        break;
     case Opcode::is_:
     case Opcode::istype_:
     case Opcode::alloc_:
@@ -734,7 +778,8 @@ void BC::print(std::ostream& out) const {
             out << "?";
             break;
         }
-        out << " ]";
+        out << " " << immediate.testFeedback.trueCount << "/"
+            << immediate.testFeedback.falseCount << " ]";
         break;
     }
 
@@ -754,12 +799,20 @@ void BC::print(std::ostream& out) const {
     case Opcode::push_code_:
         out << std::hex << immediate.fun << std::dec;
         break;
+    case Opcode::mk_arg_:
+        out << std::hex << immediate.mkArgArgs.promise << std::dec << " @"
+            << immediate.mkArgArgs.position;
+        break;
     case Opcode::beginloop_:
     case Opcode::pop_context_:
     case Opcode::push_context_:
     case Opcode::brtrue_:
     case Opcode::brfalse_:
     case Opcode::br_:
+    case Opcode::asbool_brtrue_:
+    case Opcode::asbool_brfalse_:
+    case Opcode::lt_brtrue_:
+    case Opcode::eq_brfalse_:
         out << immediate.offset;
         break;
     case Opcode::clear_binding_cache_:
@@ -165,6 +165,17 @@ BC BC::copyloc(uint32_t target, uint32_t source) {
     im.loc_cpy.source = source;
     return BC(Opcode::movloc_, im);
 }
+BC BC::ldloc2(uint32_t first, uint32_t second) {
+    ImmediateArguments im;
+    im.loc_pair.first = first;
+    im.loc_pair.second = second;
+    return BC(Opcode::ldloc2_, im);
+}
+BC BC::stlocKeep(uint32_t offset) {
+    ImmediateArguments im;
+    im.loc = offset;
+    return BC(Opcode::stloc_keep_, im);
+}
 BC BC::guardName(SEXP sym, SEXP expected) {
     ImmediateArguments i;
     i.guard_fun_args = {Pool::insert(sym), Pool::insert(expected),
@@ -184,11 +195,27 @@ BC BC::push_code(FunIdx prom) {
     i.fun = prom;
     return BC(Opcode::push_code_, i);
 }
+BC BC::region(SEXP table) {
+    ImmediateArguments i;
+    i.pool = Pool::insert(table);
+    return BC(Opcode::region_, i);
+}
+BC BC::recordBackedge(bool restartable) {
+    ImmediateArguments i;
+    i.i = restartable;
+    return BC(Opcode::record_backedge_, i);
+}
 BC BC::mkEagerPromise(FunIdx prom) {
     ImmediateArguments i;
     i.fun = prom;
     return BC(Opcode::mk_eager_promise_, i);
 }
+BC BC::mkArg(FunIdx prom, ArgIdx position) {
+    ImmediateArguments i;
+    i.mkArgArgs.promise = prom;
+    i.mkArgArgs.position = position;
+    return BC(Opcode::mk_arg_, i);
+}
 BC BC::mkPromise(FunIdx prom) {
     ImmediateArguments i;
     i.fun = prom;
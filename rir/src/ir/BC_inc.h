@@ -127,6 +127,14 @@ class BC {
         Immediate target;
         Immediate source;
     };
+    struct LocalsPair {
+        Immediate first;
+        Immediate second;
+    };
+    struct MkArgArgs {
+        FunIdx promise;
+        ArgIdx position;
+    };
     struct MkDotlistFixedArgs {
         NumArgs nargs;
     };
@@ -166,6 +174,8 @@ class BC {
         uint32_t i;
         NumLocals loc;
         LocalsCopy loc_cpy;
+        LocalsPair loc_pair;
+        MkArgArgs mkArgArgs;
         ObservedCallees callFeedback;
         ObservedValues typeFeedback;
         ObservedTest testFeedback;
@@ -275,7 +285,7 @@ class BC {
 
     bool hasPromargs() const {
         return bc == Opcode::mk_promise_ || bc == Opcode::mk_eager_promise_ ||
-               bc == Opcode::push_code_;
+               bc == Opcode::mk_arg_ || bc == Opcode::push_code_;
     }
 
     void addMyPromArgsTo(std::vector<FunIdx>& proms) {
@@ -285,13 +295,18 @@ class BC {
         case Opcode::mk_eager_promise_:
             proms.push_back(immediate.arg_idx);
             break;
+        case Opcode::mk_arg_:
+            proms.push_back(immediate.mkArgArgs.promise);
+            break;
         default: {}
         }
     }
 
     bool isCondJmp() const {
         return bc == Opcode::brtrue_ || bc == Opcode::brfalse_ ||
-               bc == Opcode::beginloop_;
+               bc == Opcode::beginloop_ || bc == Opcode::asbool_brtrue_ ||
+               bc == Opcode::asbool_brfalse_ || bc == Opcode::lt_brtrue_ ||
+               bc == Opcode::eq_brfalse_;
     }
 
     bool isUncondJmp() const { return bc == Opcode::br_; }
@@ -368,6 +383,8 @@ BC_NOARGS(V, _)
     inline static BC push(int constant);
     inline static BC push_from_pool(PoolIdx idx);
     inline static BC push_code(FunIdx i);
+    inline static BC region(SEXP table);
+    inline static BC recordBackedge(bool restartable);
     inline static BC ldfun(SEXP sym);
     inline static BC ldvar(SEXP sym);
     inline static BC ldvarNoForceStubbed(unsigned pos);
@@ -383,8 +400,11 @@ BC_NOARGS(V, _)
     inline static BC ldloc(uint32_t offset);
     inline static BC stloc(uint32_t offset);
     inline static BC copyloc(uint32_t target, uint32_t source);
+    inline static BC ldloc2(uint32_t first, uint32_t second);
+    inline static BC stlocKeep(uint32_t offset);
     inline static BC mkPromise(FunIdx prom);
     inline static BC mkEagerPromise(FunIdx prom);
+    inline static BC mkArg(FunIdx prom, ArgIdx position);
     inline static BC starg(SEXP sym);
     inline static BC stvarStubbed(unsigned stubbed);
     inline static BC stargStubbed(unsigned stubbed);
@@ -654,6 +674,7 @@ BC_NOARGS(V, _)
         case Opcode::stvar_super_:
         case Opcode::ldvar_for_update_:
         case Opcode::missing_:
+        case Opcode::region_:
             memcpy(&immediate.pool, pc, sizeof(PoolIdx));
             break;
         case Opcode::ldvar_noforce_cached_:
@@ -697,9 +718,16 @@ BC_NOARGS(V, _)
         case Opcode::push_code_:
             memcpy(&immediate.fun, pc, sizeof(FunIdx));
             break;
+        case Opcode::mk_arg_:
+            memcpy(&immediate.mkArgArgs, pc, sizeof(MkArgArgs));
+            break;
         case Opcode::br_:
         case Opcode::brtrue_:
         case Opcode::brfalse_:
+        case Opcode::asbool_brtrue_:
+        case Opcode::asbool_brfalse_:
+        case Opcode::lt_brtrue_:
+        case Opcode::eq_brfalse_:
         case Opcode::beginloop_:
         case Opcode::push_context_:
         case Opcode::pop_context_:
@@ -715,6 +743,7 @@ BC_NOARGS(V, _)
         case Opcode::ldvar_noforce_stubbed_:
         case Opcode::stvar_stubbed_:
         case Opcode::starg_stubbed_:
+        case Opcode::record_backedge_:
             memcpy(&immediate.i, pc, sizeof(uint32_t));
             break;
         case Opcode::ldarg_:
@@ -722,17 +751,21 @@ BC_NOARGS(V, _)
             break;
         case Opcode::ldloc_:
         case Opcode::stloc_:
+        case Opcode::stloc_keep_:
             memcpy(&immediate.loc, pc, sizeof(NumLocals));
             break;
         case Opcode::movloc_:
             memcpy(&immediate.loc_cpy, pc, sizeof(LocalsCopy));
             break;
+        case Opcode::ldloc2_:
+            memcpy(&immediate.loc_pair, pc, sizeof(LocalsPair));
+            break;
         case Opcode::record_call_:
             memcpy(&immediate.callFeedback, pc, sizeof(ObservedCallees));
             break;
         case Opcode::record_test_:
             memcpy(reinterpret_cast<void*>(&immediate.testFeedback), pc,
-                   sizeof(ObservedValues));
+                   sizeof(ObservedTest));
             break;
         case Opcode::record_type_:
             memcpy(reinterpret_cast<void*>(&immediate.typeFeedback), pc,
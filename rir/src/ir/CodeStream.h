@@ -32,6 +32,12 @@ class CodeStream {
 
     unsigned nextLabel = 0;
 
+    // Fuse adjacent instruction pairs into superinstructions while emitting.
+    // lastInstr is the offset of the most recently emitted instruction.
+    bool superinstructions;
+    static constexpr PcOffset NoInstr = (PcOffset)-1;
+    PcOffset lastInstr = NoInstr;
+
     // Ordered map on purpose, because FunctionWriter consumes them in order.
     // Patchpoints are positions in the BC stream that need to be patched. On
     // finalization those locations will be replaced by the physical byte offset
@@ -70,8 +76,9 @@ class CodeStream {
         insert((BC::Jmp)-1);
     }
 
-    CodeStream(FunctionWriter& function, SEXP ast)
-        : function(function), ast(ast) {
+    CodeStream(FunctionWriter& function, SEXP ast,
+               bool superinstructions = false)
+        : function(function), ast(ast), superinstructions(superinstructions) {
         code = new std::vector<char>(1024);
     }
 
@@ -84,7 +91,11 @@ class CodeStream {
     CodeStream& operator<<(const BC& b) {
         if (b.bc == Opcode::nop_)
             nops++;
+        PcOffset start = pos;
         b.write(*this);
+        if (superinstructions)
+            fuse(start);
+        lastInstr = start;
         return *this;
     }
 
@@ -144,6 +155,50 @@ class CodeStream {
         sources.erase(pc + bcSize);
     }
 
+    static Opcode superinstruction(Opcode first, Opcode second) {
+        switch (second) {
+        case Opcode::brtrue_:
+            if (first == Opcode::asbool_)
+                return Opcode::asbool_brtrue_;
+            if (first == Opcode::lt_)
+                return Opcode::lt_brtrue_;
+            break;
+        case Opcode::brfalse_:
+            if (first == Opcode::asbool_)
+                return Opcode::asbool_brfalse_;
+            if (first == Opcode::eq_)
+                return Opcode::eq_brfalse_;
+            break;
+        default:
+            break;
+        }
+        return Opcode::invalid_;
+    }
+
+    // Merges the instruction just emitted at pc with the one right before it.
+    // The first one (always without immediates) is replaced by a nop and the
+    // second one gets the fused opcode, so the immediates and patchpoints stay
+    // where they are. Jump targets in between prevent the fusion.
+    void fuse(PcOffset pc) {
+        if (lastInstr == NoInstr || lastInstr + 1 != pc || labels.count(pc))
+            return;
+        auto fused = superinstruction(*INS(lastInstr), *INS(pc));
+        if (fused == Opcode::invalid_)
+            return;
+
+        *INS(lastInstr) = Opcode::nop_;
+        nops++;
+        *INS(pc) = fused;
+
+        // The source of the first instruction is stored after it, move it
+        // behind the fused instruction.
+        auto src = sources.find(pc);
+        if (src != sources.end()) {
+            sources[pos] = src->second;
+            sources.erase(src);
+        }
+    }
+
     Code* finalize(size_t localsCnt, size_t bindingsCnt) {
         Code* res =
             function.writeCode(ast, &(*code)[0], pos, sources, patchpoints,
@@ -161,6 +216,7 @@ class CodeStream {
         delete code;
         code = nullptr;
         pos = 0;
+        lastInstr = NoInstr;
 
         CodeVerifier::calculateAndVerifyStack(res);
         return res;
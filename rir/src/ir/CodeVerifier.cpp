@@ -5,6 +5,7 @@
 #include "BC.h"
 #include "CodeVerifier.h"
 #include "R/Symbols.h"
+#include "runtime/DispatchTable.h"
 
 #include "simple_instruction_list.h"
 
@@ -122,6 +123,8 @@ static Sources hasSources(Opcode bc) {
     case Opcode::subassign1_2_:
     case Opcode::subassign2_2_:
     case Opcode::subassign1_3_:
+    case Opcode::lt_brtrue_:
+    case Opcode::eq_brfalse_:
         return Sources::Required;
 
     case Opcode::inc_:
@@ -151,6 +154,7 @@ static Sources hasSources(Opcode bc) {
     case Opcode::call_builtin_:
     case Opcode::mk_promise_:
     case Opcode::mk_eager_promise_:
+    case Opcode::mk_arg_:
     case Opcode::push_code_:
     case Opcode::br_:
     case Opcode::brtrue_:
@@ -165,6 +169,8 @@ static Sources hasSources(Opcode bc) {
     case Opcode::ldarg_:
     case Opcode::stloc_:
     case Opcode::movloc_:
+    case Opcode::ldloc2_:
+    case Opcode::stloc_keep_:
     case Opcode::nop_:
     case Opcode::mk_env_:
     case Opcode::mk_stub_env_:
@@ -193,6 +199,8 @@ static Sources hasSources(Opcode bc) {
     case Opcode::invisible_:
     case Opcode::visible_:
     case Opcode::endloop_:
+    case Opcode::region_:
+    case Opcode::record_backedge_:
     case Opcode::isstubenv_:
     case Opcode::check_missing_:
     case Opcode::lgl_and_:
@@ -217,6 +225,8 @@ static Sources hasSources(Opcode bc) {
     case Opcode::ldloc_:
     case Opcode::aslogical_:
     case Opcode::asbool_:
+    case Opcode::asbool_brtrue_:
+    case Opcode::asbool_brfalse_:
     case Opcode::missing_:
 #define V(NESTED, name, Name)\
     case Opcode::name ## _:\
@@ -329,7 +339,9 @@ void CodeVerifier::verifyFunctionLayout(SEXP sexp, InterpreterInstance* ctx) {
             }
             }
             if (*cptr == Opcode::br_ || *cptr == Opcode::brtrue_ ||
-                *cptr == Opcode::brfalse_) {
+                *cptr == Opcode::brfalse_ || *cptr == Opcode::asbool_brtrue_ ||
+                *cptr == Opcode::asbool_brfalse_ ||
+                *cptr == Opcode::lt_brtrue_ || *cptr == Opcode::eq_brfalse_) {
                 int off = *reinterpret_cast<int*>(cptr + 1);
                 if (cptr + cur.size() + off < start ||
                     cptr + cur.size() + off > end)
@@ -376,10 +388,17 @@ void CodeVerifier::verifyFunctionLayout(SEXP sexp, InterpreterInstance* ctx) {
             }
 
             if (*cptr == Opcode::mk_promise_ ||
-                *cptr == Opcode::mk_eager_promise_) {
+                *cptr == Opcode::mk_eager_promise_ ||
+                *cptr == Opcode::mk_arg_) {
                 unsigned* promidx = reinterpret_cast<Immediate*>(cptr + 1);
                 objs.push_back(c->getPromise(*promidx));
             }
+            if (*cptr == Opcode::region_) {
+                unsigned* tableIdx = reinterpret_cast<Immediate*>(cptr + 1);
+                auto table = DispatchTable::check(cp_pool_at(ctx, *tableIdx));
+                if (!table || !table->baseline()->region)
+                    Rf_error("RIR Verifier: region_ target not a region");
+            }
             if (*cptr == Opcode::named_call_) {
                 uint32_t nargs = *reinterpret_cast<Immediate*>(cptr + 1);
                 for (size_t i = 0, e = nargs; i != e; ++i) {
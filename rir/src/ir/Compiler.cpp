@@ -9,6 +9,7 @@
 #include "R/Symbols.h"
 #include "R/r.h"
 
+#include "../compiler/parameter.h"
 #include "../interpreter/cache.h"
 #include "../interpreter/safe_force.h"
 #include "utils/Pool.h"
@@ -62,6 +63,29 @@ static bool containsLoop(SEXP exp) {
     assert(false);
 }
 
+// Loops can be outlined into a region, unless they return from the enclosing
+// function. Other expressions must not break out of a loop around them
+// either. Nested closures are compiled separately and can be ignored.
+static bool canOutline(SEXP exp, bool inLoop = true) {
+    if (TYPEOF(exp) != LANGSXP)
+        return true;
+    SEXP fun = CAR(exp);
+    if (fun == symbol::Return)
+        return false;
+    if (!inLoop && (fun == symbol::Break || fun == symbol::Next))
+        return false;
+    if (fun == symbol::Function)
+        return true;
+    if (fun == symbol::While || fun == symbol::Repeat || fun == symbol::For)
+        inLoop = true;
+    if (!canOutline(fun, inLoop))
+        return false;
+    for (SEXP a = CDR(exp); a != R_NilValue; a = CDR(a))
+        if (!canOutline(CAR(a), inLoop))
+            return false;
+    return true;
+}
+
 class CompilerContext {
   public:
     class LoopContext {
@@ -83,7 +107,7 @@ class CompilerContext {
         std::unordered_map<SEXP, CacheSlotNumber> loadsSlotInCache;
 
         CodeContext(SEXP ast, FunctionWriter& fun, CodeContext* p)
-            : cs(fun, ast), parent(p) {}
+            : cs(fun, ast, Compiler::superinstructions), parent(p) {}
         virtual ~CodeContext() {}
         bool inLoop() { return !loops.empty() || (parent && parent->inLoop()); }
         BC::Label loopNext() {
@@ -132,6 +156,13 @@ class CompilerContext {
     FunctionWriter& fun;
     Preserve& preserve;
 
+    // Outline the top level loops of the function body into regions
+    bool outlineLoops = false;
+    // Set if at least one region was outlined
+    bool hasRegions = false;
+    // We are compiling the body of a region
+    bool inRegion = false;
+
     CompilerContext(FunctionWriter& fun, Preserve& preserve)
         : fun(fun), preserve(preserve) {}
 
@@ -184,13 +215,32 @@ Code* compilePromise(CompilerContext& ctx, SEXP exp);
 void compileExpr(CompilerContext& ctx, SEXP exp, bool voidContext = false);
 void compileCall(CompilerContext& ctx, SEXP ast, SEXP fun, SEXP args, bool voidContext);
 
+// The back-edges of the outermost loop of a region are counted, to find out
+// when the region gets hot. While and repeat loops keep their state in the
+// environment and can restart from the beginning of the region. The count is
+// at the end of the loop body, next jumps there instead of to the loop head.
+BC::Label mkBackedgeLabel(CompilerContext& ctx, BC::Label head) {
+    if (ctx.inRegion && ctx.code.size() == 1 && ctx.code.top()->loops.empty())
+        return ctx.cs().mkLabel();
+    return head;
+}
+
+void compileBackedge(CompilerContext& ctx, BC::Label backedge, BC::Label head,
+                     bool restartable) {
+    if (backedge != head)
+        ctx.cs() << backedge
+                 << BC::recordBackedge(restartable && !ctx.loopNeedsContext());
+}
+
 void compileWhile(CompilerContext& ctx, std::function<void()> compileCond,
-                  std::function<void()> compileBody, bool peelLoop = false) {
+                  std::function<void()> compileBody, bool peelLoop = false,
+                  bool restartable = false) {
     CodeStream& cs = ctx.cs();
 
     BC::Label nextBranch = cs.mkLabel();
     BC::Label breakBranch = cs.mkLabel();
-    ctx.pushLoop(nextBranch, breakBranch);
+    BC::Label backedgeBranch = mkBackedgeLabel(ctx, nextBranch);
+    ctx.pushLoop(backedgeBranch, breakBranch);
 
     unsigned beginLoopPos = cs.currentPos();
     cs << BC::beginloop(breakBranch);
@@ -207,6 +257,7 @@ void compileWhile(CompilerContext& ctx, std::function<void()> compileCond,
     cs << BC::brfalse(breakBranch);
 
     compileBody();
+    compileBackedge(ctx, backedgeBranch, nextBranch, restartable);
     cs << BC::br(nextBranch) << breakBranch;
 
     if (ctx.loopNeedsContext()) {
@@ -347,6 +398,33 @@ static bool maybeChanges(SEXP sym, SEXP ast) {
     return false;
 }
 
+// Compiles a loop into a separate function, which runs in the environment of
+// the caller and can therefore be optimized on its own.
+void compileRegion(CompilerContext& ctx, SEXP ast, bool voidContext) {
+    FunctionWriter region;
+    CompilerContext rctx(region, ctx.preserve);
+    rctx.inRegion = true;
+
+    rctx.push(ast, nullptr);
+    compileExpr(rctx, ast);
+    rctx.cs() << BC::ret();
+    Code* body = rctx.pop();
+    region.finalize(body,
+                    FunctionSignature(
+                        FunctionSignature::Environment::CallerProvided,
+                        FunctionSignature::OptimizationLevel::Baseline));
+    region.function()->region = true;
+
+    DispatchTable* table = DispatchTable::create(2);
+    ctx.preserve(table->container());
+    table->baseline(region.function());
+
+    ctx.cs() << BC::region(table->container());
+    if (voidContext)
+        ctx.cs() << BC::pop();
+    ctx.hasRegions = true;
+}
+
 // Inline some specials
 // TODO: once we have sufficiently powerful analysis this should (maybe?) go
 //       away and move to an optimization phase.
@@ -720,7 +798,8 @@ bool compileSpecialCall(CompilerContext& ctx, SEXP ast, SEXP fun, SEXP args_,
         BC::Label nextBranch = cs.mkLabel();
 
         compileExpr(ctx, args[0]);
-        cs << BC::asbool() << BC::brtrue(trueBranch);
+        // Recorded before asbool, which keeps it fused with the branch
+        cs << BC::recordTest() << BC::asbool() << BC::brtrue(trueBranch);
 
         if (args.length() < 3) {
             if (!voidContext) {
@@ -851,6 +930,13 @@ bool compileSpecialCall(CompilerContext& ctx, SEXP ast, SEXP fun, SEXP args_,
         return true;
     }
 
+    if ((fun == symbol::While || fun == symbol::Repeat ||
+         fun == symbol::For) &&
+        ctx.outlineLoops && ctx.code.size() == 1 && canOutline(ast)) {
+        compileRegion(ctx, ast, voidContext);
+        return true;
+    }
+
     if (fun == symbol::While) {
         assert(args.length() == 2);
 
@@ -862,10 +948,10 @@ bool compileSpecialCall(CompilerContext& ctx, SEXP ast, SEXP fun, SEXP args_,
         compileWhile(ctx,
                      [&ctx, &cs, &cond]() {
                          compileExpr(ctx, cond);
-                         cs << BC::asbool();
+                         cs << BC::recordTest() << BC::asbool();
                      },
                      [&ctx, &body]() { compileExpr(ctx, body, true); },
-                     !containsLoop(body));
+                     !containsLoop(body), true);
 
         if (!voidContext)
             cs << BC::push(R_NilValue) << BC::invisible();
@@ -882,7 +968,8 @@ bool compileSpecialCall(CompilerContext& ctx, SEXP ast, SEXP fun, SEXP args_,
 
         BC::Label nextBranch = cs.mkLabel();
         BC::Label breakBranch = cs.mkLabel();
-        ctx.pushLoop(nextBranch, breakBranch);
+        BC::Label backedgeBranch = mkBackedgeLabel(ctx, nextBranch);
+        ctx.pushLoop(backedgeBranch, breakBranch);
 
         unsigned beginLoopPos = cs.currentPos();
         cs << BC::beginloop(breakBranch);
@@ -894,6 +981,7 @@ bool compileSpecialCall(CompilerContext& ctx, SEXP ast, SEXP fun, SEXP args_,
 
         cs << nextBranch;
         compileExpr(ctx, body, true);
+        compileBackedge(ctx, backedgeBranch, nextBranch, true);
         cs << BC::br(nextBranch) << breakBranch;
 
         if (ctx.loopNeedsContext()) {
@@ -926,7 +1014,8 @@ bool compileSpecialCall(CompilerContext& ctx, SEXP ast, SEXP fun, SEXP args_,
 
         BC::Label nextBranch = cs.mkLabel();
         BC::Label breakBranch = cs.mkLabel();
-        ctx.pushLoop(nextBranch, breakBranch);
+        BC::Label backedgeBranch = mkBackedgeLabel(ctx, nextBranch);
+        ctx.pushLoop(backedgeBranch, breakBranch);
 
         // Compile the seq expression (vector) and initialize the loop
         compileExpr(ctx, seq);
@@ -973,6 +1062,7 @@ bool compileSpecialCall(CompilerContext& ctx, SEXP ast, SEXP fun, SEXP args_,
 
         // Compile the loop body
         compileExpr(ctx, body, true);
+        compileBackedge(ctx, backedgeBranch, nextBranch, false);
         cs << BC::br(nextBranch) << breakBranch;
 
         if (ctx.loopNeedsContext()) {
@@ -1118,6 +1208,15 @@ void compileCall(CompilerContext& ctx, SEXP ast, SEXP fun, SEXP args,
 
     bool hasNames = false;
     bool hasDots = false;
+
+    // In positional calls, arguments that just read a variable are created
+    // with mk_arg_, which can pass their value directly if the callee forces
+    // them on entry.
+    bool positional = true;
+    for (RListIter arg = RList(args).begin(); arg != RList::end(); ++arg)
+        if (*arg == R_DotsSymbol || arg.tag() != R_NilValue)
+            positional = false;
+
     int i = 0;
     for (RListIter arg = RList(args).begin(); arg != RList::end(); ++i, ++arg) {
         if (*arg == R_DotsSymbol) {
@@ -1157,6 +1256,9 @@ void compileCall(CompilerContext& ctx, SEXP ast, SEXP fun, SEXP args,
             }
             cs << BC::push(known);
             cs << BC::mkEagerPromise(idx);
+        } else if (positional && TYPEOF(*arg) == SYMSXP && !DDVAL(*arg) &&
+                   (size_t)i < FunctionSignature::MAX_TRACKED_ARGS) {
+            cs << BC::mkArg(idx, i);
         } else {
             cs << BC::mkPromise(idx);
         }
@@ -1251,6 +1353,33 @@ Code* compilePromise(CompilerContext& ctx, SEXP exp) {
 }  // anonymous namespace
 
 SEXP Compiler::finalize() {
+    SEXP res = finalize(false);
+
+    // Functions too big for the optimizer are compiled again, with their loops
+    // outlined into regions. The function itself stays in the interpreter, the
+    // regions are optimized separately.
+    if (isClosure && regions && containsLoop(exp) &&
+        Function::unpack(res)->body()->codeSize >
+            pir::Parameter::MAX_INPUT_SIZE)
+        res = finalize(true);
+
+    return res;
+}
+
+SEXP Compiler::compileRegion(SEXP ast) {
+    if (!canOutline(ast, false))
+        return nullptr;
+
+    Compiler c(ast);
+    SEXP res = PROTECT(c.finalize());
+    Function::unpack(res)->region = true;
+    DispatchTable* table = DispatchTable::create(2);
+    table->baseline(Function::unpack(res));
+    UNPROTECT(1);
+    return table->container();
+}
+
+SEXP Compiler::finalize(bool outlineLoops) {
     FunctionWriter function;
     CompilerContext ctx(function, preserve);
 
@@ -1268,11 +1397,14 @@ SEXP Compiler::finalize() {
         signature.pushDefaultArgument();
     }
 
+    ctx.outlineLoops = outlineLoops;
     ctx.push(exp, closureEnv);
     compileExpr(ctx, exp);
     ctx.cs() << BC::ret();
     Code* body = ctx.pop();
     function.finalize(body, signature);
+    if (ctx.hasRegions)
+        function.function()->unoptimizable = true;
 
 #ifdef ENABLE_SLOWASSERT
     CodeVerifier::verifyFunctionLayout(function.function()->container(),
@@ -1292,4 +1424,12 @@ bool Compiler::profile =
 
 bool Compiler::loopPeelingEnabled = true;
 
+bool Compiler::superinstructions =
+    !(getenv("RIR_SUPERINSTRUCTIONS") &&
+      std::string(getenv("RIR_SUPERINSTRUCTIONS")).compare("off") == 0);
+
+bool Compiler::regions =
+    !(getenv("RIR_REGIONS") &&
+      std::string(getenv("RIR_REGIONS")).compare("off") == 0);
+
 } // namespace rir
@@ -24,25 +24,31 @@ class Compiler {
     SEXP exp;
     SEXP formals;
     SEXP closureEnv;
+    bool isClosure;
 
     Preserve preserve;
 
     explicit Compiler(SEXP exp)
-        : exp(exp), formals(R_NilValue), closureEnv(nullptr) {
+        : exp(exp), formals(R_NilValue), closureEnv(nullptr),
+          isClosure(false) {
         preserve(exp);
     }
 
     Compiler(SEXP exp, SEXP formals, SEXP env)
-        : exp(exp), formals(formals), closureEnv(env) {
+        : exp(exp), formals(formals), closureEnv(env), isClosure(true) {
         preserve(exp);
         preserve(formals);
         preserve(env);
     }
 
+    SEXP finalize(bool outlineLoops);
+
   public:
     static bool profile;
     static bool unsoundOpts;
     static bool loopPeelingEnabled;
+    static bool superinstructions;
+    static bool regions;
 
     SEXP finalize();
 
@@ -74,6 +80,10 @@ class Compiler {
         return res;
     }
 
+    // Compiles an expression into a region, which runs in the env it is
+    // evaluated in. Returns nullptr if the expression cannot be outlined.
+    static SEXP compileRegion(SEXP ast);
+
     // To compile a function which is not yet closed
     static SEXP compileFunction(SEXP ast, SEXP formals) {
         Compiler c(ast, formals, nullptr);
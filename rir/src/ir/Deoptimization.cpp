@@ -15,6 +15,7 @@ FrameInfo FrameInfo::deserialize(const Opcode* anchor, SEXP refTable,
 
 void FrameInfo::serialize(const Opcode* anchor, SEXP refTable,
                           R_outpstream_t out) const {
+    code->registerUid();
     code->uid.serialize(refTable, out);
     OutInteger(out, pc - code->code());
     OutInteger(out, stackSize);
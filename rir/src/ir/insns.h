@@ -170,6 +170,16 @@ DEF_INSTR(stloc_, 1, 1, 0, 1)
  */
 DEF_INSTR(movloc_, 2, 0, 0, 1)
 
+/**
+ * ldloc2_:: push two local variables on stack (first immediate pushed first)
+ */
+DEF_INSTR(ldloc2_, 2, 0, 2, 1)
+
+/**
+ * stloc_keep_:: store top of stack to local variable, without popping it
+ */
+DEF_INSTR(stloc_keep_, 1, 1, 1, 1)
+
 /**
  * call_:: Call instruction. Takes n arguments on the stack
  *         on top of the callee; these arguments can be
@@ -221,6 +231,14 @@ DEF_INSTR(isfun_, 0, 1, 1, 1)
  */
 DEF_INSTR(mk_eager_promise_, 1, 1, 1, 1)
 DEF_INSTR(mk_promise_, 1, 0, 1, 1)
+
+/**
+ * mk_arg_:: like mk_promise_, the second immediate is the position of the
+ *           argument in the call. If the callee forces this argument on entry
+ *           and the promise only reads an already evaluated local variable,
+ *           the value is pushed instead of a new promise.
+ */
+DEF_INSTR(mk_arg_, 2, 0, 1, 1)
 DEF_INSTR(update_promise_, 0, 2, 0, 0)
 
 /**
@@ -402,6 +420,32 @@ DEF_INSTR(brfalse_, 1, 1, 0, 1)
  */
 DEF_INSTR(br_, 1, 0, 0, 1)
 
+/*
+ * Superinstructions: fused versions of the hottest instruction pairs emitted
+ * by the baseline compiler (see CodeStream::fuse). They behave exactly like
+ * the two instructions executed back to back, but only pay one dispatch.
+ */
+
+/**
+ * asbool_brtrue_:: asbool_ followed by brtrue_ (condition of `if`)
+ */
+DEF_INSTR(asbool_brtrue_, 1, 1, 0, 0)
+
+/**
+ * asbool_brfalse_:: asbool_ followed by brfalse_ (condition of `while`)
+ */
+DEF_INSTR(asbool_brfalse_, 1, 1, 0, 0)
+
+/**
+ * lt_brtrue_:: lt_ followed by brtrue_ (bounds check of `for` loops)
+ */
+DEF_INSTR(lt_brtrue_, 1, 2, 0, 0)
+
+/**
+ * eq_brfalse_:: eq_ followed by brfalse_ (condition of simple `for` loops)
+ */
+DEF_INSTR(eq_brfalse_, 1, 2, 0, 0)
+
 /**
  * extract1_1_:: do a[b], where a and b are on the stack and a is no obj
  */
@@ -544,6 +588,19 @@ DEF_INSTR(beginloop_, 1, 0, 0, 0)
  */
 DEF_INSTR(endloop_, 0, 0, 0, 0)
 
+/**
+ * region_:: run the loop nest outlined into the region with the immediate CP
+ * index (a dispatch table) in the current environment, push its result
+ */
+DEF_INSTR(region_, 1, 0, 1, 0)
+
+/**
+ * record_backedge_:: count a back-edge of the outermost loop of a region. If
+ * the immediate is set, the loop can be restarted from the beginning of the
+ * region, which then happens once it gets hot.
+ */
+DEF_INSTR(record_backedge_, 1, 0, 0, 0)
+
 /**
  * return_ :: return instruction. Non-local return instruction as opposed to
  * ret_.
@@ -566,7 +623,7 @@ DEF_INSTR(deopt_, 1, -1, 0, 0)
  * heavy in size.
  */
 DEF_INSTR(record_call_, 4, 1, 1, 0)
-DEF_INSTR(record_type_, 1, 1, 1, 0)
+DEF_INSTR(record_type_, 2, 1, 1, 0)
 DEF_INSTR(record_test_, 1, 1, 1, 0)
 DEF_INSTR(record_deopt_, 4, 1, 0, 0)
 
@@ -13,26 +13,47 @@ std::unordered_map<UUID, Code*> allCodes;
 
 Code* Code::withUid(UUID uid) { return allCodes.at(uid); }
 
+static void forgetUid(SEXP liveness) {
+    // The liveness token keeps the code alive until now
+    auto code = static_cast<Code*>(R_ExternalPtrAddr(liveness));
+    // Deserializing the same code twice yields two objects with one uid
+    auto e = allCodes.find(code->uid);
+    if (e != allCodes.end() && e->second == code)
+        allCodes.erase(e);
+}
+
+// Only code referenced by uid is registered, since R scans all finalizers on
+// every full collection
+void Code::registerUid() {
+    allCodes[uid] = this;
+    if (!uidRegistered) {
+        R_RegisterCFinalizerEx(liveness(), forgetUid, FALSE);
+        uidRegistered = true;
+    }
+}
+
 // cppcheck-suppress uninitMemberVar symbol=data
 Code::Code(FunctionSEXP fun, unsigned src, unsigned cs, unsigned sourceLength,
            size_t localsCnt, size_t bindingsCnt)
     : RirRuntimeObject(
           // GC area starts just after the header
           (intptr_t)&locals_ - (intptr_t)this,
-          // GC area has only 1 pointer
+          // GC area has the extra pool, the region and the liveness token
           NumLocals),
       nativeCode(nullptr), uid(UUID::random()), funInvocationCount(0),
-      deoptCount(0), needsFullEnv(false), src(src), stackLength(0),
+      deoptCount(0), forceCount(0), needsFullEnv(false), optimized(false),
+      uidRegistered(false), src(src), stackLength(0),
       localsCount(localsCnt), bindingCacheSize(bindingsCnt), codeSize(cs),
       srcLength(sourceLength), extraPoolSize(0) {
     setEntry(0, R_NilValue);
-    allCodes.emplace(uid, this);
+    setEntry(1, R_NilValue);
+    setEntry(2, R_NilValue);
 }
 
-Code::~Code() {
-    // TODO: Not sure if this is actually called
-    // Otherwise the pointer will leak a few bytes
-    allCodes.erase(uid);
+SEXP Code::liveness() {
+    if (getEntry(2) == R_NilValue)
+        setEntry(2, R_MakeExternalPtr(this, R_NilValue, container()));
+    return getEntry(2);
 }
 
 unsigned Code::getSrcIdxAt(const Opcode* pc, bool allowMissing) const {
@@ -74,6 +95,26 @@ unsigned Code::getSrcIdxAt(const Opcode* pc, bool allowMissing) const {
     return sidx;
 }
 
+unsigned Code::getSrcIdxBefore(const Opcode* pc) const {
+    SrclistEntry* sl = srclist();
+    auto pcOffset = pc - code();
+
+    // Binary search for the last entry not after pc
+    int lower = 0;
+    int upper = srcLength - 1;
+    unsigned sidx = 0;
+    while (lower <= upper) {
+        int finger = lower + (upper - lower) / 2;
+        if (sl[finger].pcOffset <= pcOffset) {
+            sidx = sl[finger].srcIdx;
+            lower = finger + 1;
+        } else {
+            upper = finger - 1;
+        }
+    }
+    return sidx;
+}
+
 Code* Code::deserialize(SEXP refTable, R_inpstream_t inp) {
     size_t size = InInteger(inp);
     SEXP store = Rf_allocVector(EXTERNALSXP, size);
@@ -83,6 +124,7 @@ Code* Code::deserialize(SEXP refTable, R_inpstream_t inp) {
     code->nativeCode = nullptr; // not serialized for now
     code->funInvocationCount = InInteger(inp);
     code->deoptCount = InInteger(inp);
+    code->optimized = InInteger(inp);
     code->src = InInteger(inp);
     code->stackLength = InInteger(inp);
     *const_cast<unsigned*>(&code->localsCount) = InInteger(inp);
@@ -104,11 +146,10 @@ Code* Code::deserialize(SEXP refTable, R_inpstream_t inp) {
     }
     code->info = {// GC area starts just after the header
                   (uint32_t)((intptr_t)&code->locals_ - (intptr_t)code),
-                  // GC area has only 1 pointer
                   NumLocals, CODE_MAGIC};
     code->setEntry(0, extraPool);
+    code->registerUid();
     UNPROTECT(2);
-    allCodes.emplace(code->uid, code);
 
     return code;
 }
@@ -119,6 +160,7 @@ void Code::serialize(SEXP refTable, R_outpstream_t out) const {
     uid.serialize(refTable, out);
     OutInteger(out, funInvocationCount);
     OutInteger(out, deoptCount);
+    OutInteger(out, optimized);
     OutInteger(out, src);
     OutInteger(out, stackLength);
     OutInteger(out, localsCount);
@@ -51,20 +51,27 @@ typedef SEXP (*NativeCode)(Code*, void*, SEXP, SEXP);
 struct Code : public RirRuntimeObject<Code, CODE_MAGIC> {
     friend class FunctionWriter;
     friend class CodeVerifier;
-    static constexpr size_t NumLocals = 1;
+    static constexpr size_t NumLocals = 3;
 
+    // Only code referenced by serialized deopt metadata, or deserialized, is
+    // found by its uid. It is dropped from the uid map once collected.
     static Code* withUid(UUID uid);
+    void registerUid();
 
     Code(FunctionSEXP fun, unsigned src, unsigned codeSize, unsigned sourceSize,
          size_t localsCnt, size_t bindingsCacheSize);
-    ~Code();
 
   private:
     Code() : Code(NULL, 0, 0, 0, 0, 0) {}
     /*
-     * This array contains the GC reachable pointers. Currently there are two
-     * of them.
+     * This array contains the GC reachable pointers. Currently there are
+     * three of them.
      * 0 : the extra pool for attaching additional GC'd object to the code.
+     * 1 : a closure with the dispatch table of the region compiled from
+     *     this code as body, once it got hot as a promise, or nil. It is
+     *     reused for every run of the region. Not serialized.
+     * 2 : an external pointer to the code, see liveness(), or nil. Not
+     *     serialized.
      */
     SEXP locals_[NumLocals];
 
@@ -89,8 +96,18 @@ struct Code : public RirRuntimeObject<Code, CODE_MAGIC> {
     unsigned funInvocationCount;
     unsigned deoptCount;
 
+    // number of times a baseline promise was forced, until it is compiled to
+    // a region. Not serialized.
+    unsigned forceCount;
+
     unsigned needsFullEnv : 1;
 
+    // Set for code emitted by Pir2Rir, including its promises
+    unsigned optimized : 1;
+
+    // Set once the uid map drops this code when it is collected
+    unsigned uidRegistered : 1;
+
     unsigned src; /// AST of the function (or promise) represented by the code
 
     unsigned stackLength; /// Number of slots in stack required
@@ -139,6 +156,14 @@ struct Code : public RirRuntimeObject<Code, CODE_MAGIC> {
         return VECTOR_ELT(getEntry(0), i);
     }
 
+    SEXP region() const { return getEntry(1); }
+    void region(SEXP closure) { setEntry(1, closure); }
+
+    // An external pointer which is only reachable through this code, thus
+    // dies with it. R can only weakly reference envs and external pointers.
+    // It keeps the code alive until its weak references are cleared.
+    SEXP liveness();
+
     Code* getPromise(size_t idx) const {
         return unpack(getExtraPoolEntry(idx));
     }
@@ -152,6 +177,9 @@ struct Code : public RirRuntimeObject<Code, CODE_MAGIC> {
     }
 
     unsigned getSrcIdxAt(const Opcode* pc, bool allowMissing) const;
+    // Source of the closest instruction at or before pc which has one, 0 if
+    // there is none
+    unsigned getSrcIdxBefore(const Opcode* pc) const;
 
     static Code* deserialize(SEXP refTable, R_inpstream_t inp);
     void serialize(SEXP refTable, R_outpstream_t out) const;
@@ -53,7 +53,7 @@ struct DispatchTable
         }
         if (i == size())
             return;
-        get(i)->dead = true;
+        get(i)->kill();
         for (; i < size() - 1; ++i) {
             setEntry(i, getEntry(i + 1));
         }
@@ -73,7 +73,7 @@ struct DispatchTable
             if (get(i)->signature().assumptions == assumptions) {
                 // If we override a version we should ensure that we don't call
                 // the old version anymore, or we might end up in a deopt loop.
-                get(i)->dead = true;
+                get(i)->kill();
                 setEntry(i, fun->container());
                 return;
             }
@@ -97,6 +97,7 @@ struct DispatchTable
 #endif
             // Evict one element and retry
             // TODO: find a better solution here!
+            get(size() - 1)->kill();
             size_--;
             return insert(fun);
         }
@@ -50,7 +50,7 @@ struct Function : public RirRuntimeObject<Function, FUNCTION_MAGIC> {
               NUM_PTRS + defaultArgs.size()),
           size(functionSize), deopt(false), markOpt(false),
           unoptimizable(false), uninlinable(false), dead(false),
-          innerFunction(false), numArgs(defaultArgs.size()),
+          innerFunction(false), region(false), numArgs(defaultArgs.size()),
           signature_(signature) {
         for (size_t i = 0; i < numArgs; ++i)
             setEntry(NUM_PTRS + i, defaultArgs[i]);
@@ -58,6 +58,13 @@ struct Function : public RirRuntimeObject<Function, FUNCTION_MAGIC> {
     }
 
     Code* body() const { return Code::unpack(getEntry(0)); }
+
+    // Dead versions are not dispatched to anymore. Native code calls them
+    // through the native code slot of their body, which is cleared.
+    void kill() {
+        dead = true;
+        body()->nativeCode = nullptr;
+    }
     void body(SEXP body) { setEntry(0, body); }
 
     static Function* deserialize(SEXP refTable, R_inpstream_t inp);
@@ -84,6 +91,9 @@ struct Function : public RirRuntimeObject<Function, FUNCTION_MAGIC> {
     unsigned uninlinable : 1;
     unsigned dead : 1;
     unsigned innerFunction : 1;
+    // A loop nest outlined by the baseline compiler (see region_). It has no
+    // arguments and runs in the environment of the function it is part of.
+    unsigned region : 1;
 
     unsigned numArgs;
 
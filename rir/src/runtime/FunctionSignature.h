@@ -85,6 +85,8 @@ struct FunctionSignature {
         for (unsigned i = 0; i < numArgs; i++) {
             sig.pushArgument(ArgumentType::deserialize(refTable, inp));
         }
+        sig.forcedOnEntry = InInteger(inp);
+        sig.jumpTarget = InInteger(inp);
         return sig;
     }
 
@@ -98,6 +100,8 @@ struct FunctionSignature {
                 (i < MAX_TRACKED_ARGS) ? arguments[i] : ArgumentType();
             arg.serialize(refTable, out);
         }
+        OutInteger(out, forcedOnEntry);
+        OutInteger(out, jumpTarget);
     }
 
     void print(std::ostream& out = std::cout) const {
@@ -115,10 +119,19 @@ struct FunctionSignature {
             }
             out << ") ";
         }
+        if (forcedOnEntry) {
+            out << "forcesOnEntry: (";
+            for (unsigned i = 0; i < MAX_TRACKED_ARGS; i++)
+                if (forcesOnEntry(i))
+                    out << i << " ";
+            out << ") ";
+        }
         if (optimization != OptimizationLevel::Baseline)
             out << "optimized code ";
         if (envCreation == Environment::CallerProvided)
             out << "needsEnv ";
+        if (!jumpTarget)
+            out << "noSetjmp ";
         if (!assumptions.empty()) {
             out << "| assumptions: [" << assumptions << "]";
         }
@@ -138,11 +151,26 @@ struct FunctionSignature {
         return numArguments - assumptions.numMissing();
     }
 
+    // Arguments which this version forces before any other effect and never
+    // reflects on. Callers can pass their values instead of promises. Only
+    // the argument forced first is set, forcing it could change the others.
+    bool forcesOnEntry(size_t i) const {
+        return i < MAX_TRACKED_ARGS && (forcedOnEntry & (1 << i));
+    }
+    void setForcesOnEntry(size_t i) {
+        if (i < MAX_TRACKED_ARGS)
+            forcedOnEntry |= 1 << i;
+    }
+
     static const unsigned MAX_TRACKED_ARGS = 4;
     const Environment envCreation;
     const OptimizationLevel optimization;
     ArgumentType arguments[MAX_TRACKED_ARGS];
     unsigned numArguments = 0;
+    unsigned forcedOnEntry = 0;
+    // If false, nothing can long-jump into the context of this version and
+    // it is called without a setjmp.
+    bool jumpTarget = true;
     const Assumptions assumptions;
 };
 
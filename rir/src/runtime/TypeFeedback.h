@@ -73,10 +73,16 @@ static_assert(sizeof(ObservedCallees) == 4 * sizeof(uint32_t),
 
 struct ObservedTest {
     enum { None, OnlyTrue, OnlyFalse, Both };
+    static constexpr unsigned CounterBits = 15;
+    static constexpr unsigned CounterOverflow = (1 << CounterBits) - 1;
+
     uint32_t seen : 2;
-    uint32_t unused : 30;
+    // How often each branch was taken. Both are halved when one of them
+    // overflows, which keeps their ratio and favors recent behavior.
+    uint32_t trueCount : CounterBits;
+    uint32_t falseCount : CounterBits;
 
-    ObservedTest() : seen(0), unused(0) {}
+    ObservedTest() : seen(0), trueCount(0), falseCount(0) {}
 
     RIR_INLINE void record(SEXP e) {
         if (e == R_TrueValue) {
@@ -84,6 +90,7 @@ struct ObservedTest {
                 seen = OnlyTrue;
             else if (seen != OnlyTrue)
                 seen = Both;
+            count(true);
             return;
         }
         if (e == R_FalseValue) {
@@ -91,11 +98,32 @@ struct ObservedTest {
                 seen = OnlyFalse;
             else if (seen != OnlyFalse)
                 seen = Both;
+            count(false);
             return;
         }
         if (seen != Both)
             seen = Both;
     }
+
+    // True if the branch was taken at most once every ratio times, and
+    // executed often enough for that to mean something
+    bool rarely(bool branch, unsigned ratio) const {
+        unsigned taken = branch ? trueCount : falseCount;
+        unsigned total = trueCount + falseCount;
+        return seen == Both && total >= ratio && taken * ratio <= total;
+    }
+
+  private:
+    RIR_INLINE void count(bool branch) {
+        if ((branch ? trueCount : falseCount) == CounterOverflow) {
+            trueCount = trueCount / 2;
+            falseCount = falseCount / 2;
+        }
+        if (branch)
+            trueCount++;
+        else
+            falseCount++;
+    }
 };
 static_assert(sizeof(ObservedTest) == sizeof(uint32_t),
               "Size needs to fit inside a record_ bc immediate args");
@@ -110,34 +138,77 @@ struct ObservedValues {
     };
 
     static constexpr unsigned MaxTypes = 3;
+    static constexpr unsigned CounterBits = 10;
+    static constexpr unsigned CounterOverflow = (1 << CounterBits) - 1;
+
     uint8_t numTypes : 2;
     uint8_t stateBeforeLastForce : 2;
-    uint8_t unused : 4;
+    // Set when speculating on the dominant type failed
+    uint8_t unstable : 1;
+    uint8_t unused : 3;
 
     std::array<ObservedType, MaxTypes> seen;
 
+    // How often each of the seen types was recorded, CounterBits per type.
+    // All counters are halved when one overflows, which keeps their ratios.
+    uint32_t counts;
+
     ObservedValues()
         : numTypes(0), stateBeforeLastForce(StateBeforeLastForce::unknown),
-          unused(0) {}
+          unstable(0), unused(0), counts(0) {}
 
     RIR_INLINE void record(SEXP e) {
         ObservedType type(e);
-        if (numTypes < MaxTypes) {
-            int i = 0;
-            for (; i < numTypes; ++i) {
-                if (seen[i] == type)
-                    break;
-                if (seen[i].sexptype == type.sexptype) {
-                    seen[i] = seen[i] | type;
-                    return;
-                }
+        unsigned i = 0;
+        for (; i < numTypes; ++i) {
+            if (seen[i] == type)
+                break;
+            if (seen[i].sexptype == type.sexptype) {
+                seen[i] = seen[i] | type;
+                break;
             }
-            if (i == numTypes)
-                seen[numTypes++] = type;
         }
+        if (i == numTypes) {
+            if (numTypes == MaxTypes)
+                return;
+            seen[numTypes++] = type;
+        }
+        count(i);
+    }
+
+    unsigned hits(unsigned i) const {
+        return (counts >> (i * CounterBits)) & CounterOverflow;
+    }
+
+    // The index of the seen type which makes up all but at most one in ratio
+    // of the recorded values, or -1. Needs at least ratio recorded values.
+    int dominant(unsigned ratio) const {
+        if (!ratio || unstable || numTypes < 2 || numTypes == MaxTypes)
+            return -1;
+        unsigned total = 0;
+        unsigned best = 0;
+        for (unsigned i = 0; i < numTypes; ++i) {
+            total += hits(i);
+            if (hits(i) > hits(best))
+                best = i;
+        }
+        if (total < ratio || (total - hits(best)) * ratio > total)
+            return -1;
+        return best;
+    }
+
+  private:
+    RIR_INLINE void count(unsigned i) {
+        if (hits(i) == CounterOverflow) {
+            uint32_t halved = 0;
+            for (unsigned j = 0; j < MaxTypes; ++j)
+                halved |= (hits(j) / 2) << (j * CounterBits);
+            counts = halved;
+        }
+        counts += 1 << (i * CounterBits);
     }
 };
-static_assert(sizeof(ObservedValues) == sizeof(uint32_t),
+static_assert(sizeof(ObservedValues) == 2 * sizeof(uint32_t),
               "Size needs to fit inside a record_ bc immediate args");
 
 enum class TypeChecks : uint32_t {